@@ -0,0 +1,174 @@
+// g++ -std=c++20 -O2 -Wall -Wextra -DNDEBUG -pthread -o bench src/bench.cpp
+#include "delaunay.hpp"
+#include "dsatur.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <numbers>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <algorithm>
+
+namespace {
+    using Generator = std::function<std::vector<double>(uint32_t, std::mt19937_64&)>;
+
+    std::vector<double> uniform(const uint32_t n, std::mt19937_64& rng) {
+        std::uniform_real_distribution<double> u(0.0, 1.0);
+        std::vector<double> xy(2*n);
+        for (auto& v : xy) v = u(rng);
+        return xy;
+    }
+
+    std::vector<double> clustered(const uint32_t n, std::mt19937_64& rng) {
+        const uint32_t k = std::max<uint32_t>(1, std::sqrt(n) / 4);
+        std::uniform_real_distribution<double> u(0.0, 1.0);
+        std::vector<double> cx(k), cy(k);
+        for (uint32_t i{}; i < k; i++) {cx[i] = u(rng); cy[i] = u(rng);}
+        std::normal_distribution<double> g(0.0, 0.2 / std::sqrt(k));
+        std::uniform_int_distribution<uint32_t> pick(0, k - 1);
+        std::vector<double> xy(2*n);
+        for (uint32_t i{}; i < n; i++) {
+            const uint32_t c = pick(rng);
+            xy[2*i] = cx[c] + g(rng);
+            xy[2*i + 1] = cy[c] + g(rng);
+        }
+        return xy;
+    }
+
+    std::vector<double> grid(const uint32_t n, std::mt19937_64&) {
+        const uint32_t w = std::ceil(std::sqrt(n));
+        std::vector<double> xy(2*n);
+        for (uint32_t i{}; i < n; i++) {
+            xy[2*i] = i % w;
+            xy[2*i + 1] = i / w;
+        }
+        return xy;
+    }
+
+    std::vector<double> collinear(const uint32_t n, std::mt19937_64& rng) {
+        std::uniform_real_distribution<double> u(0.0, 1.0);
+        std::vector<double> xy(2*n);
+        for (uint32_t i{}; i < n; i++) xy[2*i] = xy[2*i + 1] = u(rng);
+        return xy;
+    }
+
+    std::vector<double> circle(const uint32_t n, std::mt19937_64&) {
+        std::vector<double> xy(2*n);
+        for (uint32_t i{}; i < n; i++) {
+            const double a = 2*std::numbers::pi*i / n;
+            xy[2*i] = std::cos(a);
+            xy[2*i + 1] = std::sin(a);
+        }
+        return xy;
+    }
+
+    void reset_peak() {
+        std::ofstream("/proc/self/clear_refs") << "5";
+    }
+
+    double peak_mb() {
+        std::ifstream in("/proc/self/status");
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.rfind("VmHWM:", 0) == 0) return std::atof(line.c_str() + 6) / 1024.0;
+        }
+        return 0.0;
+    }
+
+    double seconds(const std::chrono::steady_clock::time_point& t) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+    }
+
+    struct Result {
+        double build_s{}, color_s{};
+        uint64_t flips{};
+        int colors{};
+    };
+
+    template <class Scalar>
+    Result run(std::vector<double> xy, const delaunay::BuildOptions& build, const dsatur::Options& coloring) {
+        Result r;
+        delaunay::BasicTriangulation<Scalar> mesh;
+        mesh.reserve(xy.size() / 2);
+        for (size_t i{}; i + 1 < xy.size(); i += 2) mesh.addPoint(xy[i], xy[i + 1]);
+        std::vector<double>().swap(xy);
+        auto t = std::chrono::steady_clock::now();
+        mesh.build(build);
+        r.build_s = seconds(t);
+        r.flips = mesh.getFlips();
+        t = std::chrono::steady_clock::now();
+        const dsatur::Graph G(mesh.getPoints().size(), mesh.getEdges(), mesh.getTriangles());
+        const auto color = dsatur::color_point(G, coloring);
+        r.color_s = seconds(t);
+        r.colors = color.empty() ? 0 : *std::max_element(color.begin(), color.end()) + 1;
+        return r;
+    }
+
+    void usage() {
+        std::fprintf(stderr,
+            "usage: bench [options]\n"
+            "  --min N          smallest point count (default 1000)\n"
+            "  --max N          largest point count (default 1000000, up to 10000000)\n"
+            "  --dist NAME      uniform | clustered | grid | collinear | circle (default: all)\n"
+            "  -j N             worker threads\n"
+            "  --hilbert        Hilbert/BRIO insertion order\n"
+            "  --float          store coordinates as float\n"
+            "  --engine E       dsatur | jp | sl\n"
+            "  --seed S         random seed\n");
+    }
+}
+
+int main(int argc, char** argv) {
+    uint32_t lo = 1000, hi = 1000000;
+    uint64_t seed = 1;
+    std::string only;
+    bool single = false;
+    delaunay::BuildOptions build;
+    dsatur::Options coloring;
+    for (int i = 1; i < argc; i++) {
+        const std::string s = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (s == "--hilbert") {build.order = delaunay::InsertionOrder::Hilbert; continue;}
+        if (s == "--float") {single = true; continue;}
+        if (v == nullptr) {usage(); return 2;}
+        i++;
+        if (s == "--min") lo = std::atoi(v);
+        else if (s == "--max") hi = std::atoi(v);
+        else if (s == "--dist") only = v;
+        else if (s == "-j") build.threads = coloring.threads = std::max(1, std::atoi(v));
+        else if (s == "--seed") seed = std::strtoull(v, nullptr, 10);
+        else if (s == "--engine") {
+            const std::string e = v;
+            if (e == "dsatur") coloring.engine = dsatur::Engine::DSatur;
+            else if (e == "jp") coloring.engine = dsatur::Engine::JonesPlassmann;
+            else if (e == "sl") coloring.engine = dsatur::Engine::SmallestLast;
+            else {usage(); return 2;}
+        }
+        else {usage(); return 2;}
+    }
+    const std::pair<const char*, Generator> dists[] = {
+        {"uniform", uniform},
+        {"clustered", clustered},
+        {"grid", grid},
+        {"collinear", collinear},
+        {"circle", circle},
+    };
+    std::printf("%-10s %9s %10s %12s %10s %7s %10s\n", "dist", "n", "build_s", "flips", "color_s", "colors", "peak_mb");
+    for (const auto& [name, gen] : dists) {
+        if (!only.empty() && only != name) continue;
+        for (uint64_t n = lo; n <= hi; n *= 10) {
+            std::mt19937_64 rng(seed);
+            reset_peak();
+            const Result r = single ? run<float>(gen(n, rng), build, coloring) : run<double>(gen(n, rng), build, coloring);
+            std::printf("%-10s %9llu %10.3f %12llu %10.3f %7d %10.1f\n", name, (unsigned long long)n,
+                        r.build_s, (unsigned long long)r.flips, r.color_s, r.colors, peak_mb());
+            std::fflush(stdout);
+        }
+    }
+    return 0;
+}
\ No newline at end of file
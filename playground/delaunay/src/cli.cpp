@@ -0,0 +1,162 @@
+// g++ -std=c++20 -O2 -Wall -Wextra -DNDEBUG -pthread -o delaunay src/cli.cpp
+#include "delaunay.hpp"
+#include "dsatur.hpp"
+#include "export.hpp"
+#include "load.hpp"
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <chrono>
+
+namespace {
+    struct Args {
+        const char* input = nullptr;
+        const char* edges = nullptr;
+        const char* triangles = nullptr;
+        const char* colors = nullptr;
+        std::string color;
+        delaunay::BuildOptions build;
+        dsatur::Options coloring;
+        bool binary = false;
+    };
+
+    void usage() {
+        std::fprintf(stderr,
+            "usage: delaunay INPUT [options]\n"
+            "  INPUT            binary point file or text with one \"x y\" / \"x,y\" per line\n"
+            "  -j N             worker threads\n"
+            "  --hilbert        Hilbert/BRIO insertion order\n"
+            "  --verify         check the result is a valid Delaunay triangulation\n"
+            "  --color MODE     point | edge | face\n"
+            "  --engine E       dsatur | jp | sl\n"
+            "  --edges PATH     write the edge list (\"-\" for stdout)\n"
+            "  --triangles PATH write the triangles\n"
+            "  --colors PATH    write one color per vertex / edge / face\n"
+            "  --binary         write edges and triangles in the binary format\n");
+    }
+
+    bool parse(const int argc, char** argv, Args& a) {
+        for (int i = 1; i < argc; i++) {
+            const std::string s = argv[i];
+            const auto value = [&]() -> const char* {return i + 1 < argc ? argv[++i] : nullptr;};
+            if (s == "-j") {
+                const char* v = value();
+                if (v == nullptr) return false;
+                a.build.threads = a.coloring.threads = std::max(1, std::atoi(v));
+            }
+            else if (s == "--hilbert") a.build.order = delaunay::InsertionOrder::Hilbert;
+            else if (s == "--binary") a.binary = true;
+            else if (s == "--verify") a.build.verify = true;
+            else if (s == "--color") {
+                const char* v = value();
+                if (v == nullptr) return false;
+                a.color = v;
+                if (a.color != "point" && a.color != "edge" && a.color != "face") return false;
+            }
+            else if (s == "--engine") {
+                const char* v = value();
+                if (v == nullptr) return false;
+                const std::string e = v;
+                if (e == "dsatur") a.coloring.engine = dsatur::Engine::DSatur;
+                else if (e == "jp") a.coloring.engine = dsatur::Engine::JonesPlassmann;
+                else if (e == "sl") a.coloring.engine = dsatur::Engine::SmallestLast;
+                else return false;
+            }
+            else if (s == "--edges") {if ((a.edges = value()) == nullptr) return false;}
+            else if (s == "--triangles") {if ((a.triangles = value()) == nullptr) return false;}
+            else if (s == "--colors") {if ((a.colors = value()) == nullptr) return false;}
+            else if (a.input == nullptr && s[0] != '-') a.input = argv[i];
+            else return false;
+        }
+        if (a.colors != nullptr && a.color.empty()) return false;
+        return a.input != nullptr;
+    }
+
+    template <class F>
+    bool write(const char* path, F&& f) {
+        std::FILE* fp = std::strcmp(path, "-") == 0 ? stdout : std::fopen(path, "wb");
+        if (fp == nullptr) {
+            std::fprintf(stderr, "cannot open %s\n", path);
+            return false;
+        }
+        {
+            io::Writer w(fp);
+            f(w);
+        }
+        return fp == stdout ? std::fflush(fp) == 0 : std::fclose(fp) == 0;
+    }
+
+    double seconds(const std::chrono::steady_clock::time_point& t) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+    }
+}
+
+int main(int argc, char** argv) {
+    Args a;
+    if (!parse(argc, argv, a)) {
+        usage();
+        return 2;
+    }
+    auto t = std::chrono::steady_clock::now();
+    delaunay::DelaunayTriangulation mesh;
+    {
+        const io::MappedFile file(a.input);
+        if (!file) {
+            std::fprintf(stderr, "cannot read %s\n", a.input);
+            return 1;
+        }
+        const auto xy = io::view<double>(file.data(), file.size(), io::Kind::Points);
+        if (!xy.empty()) mesh.addPoints(xy);
+        else mesh.addPoints(io::parse_points(file.text()));
+    }
+    std::fprintf(stderr, "load   %9.3fs  %zu points\n", seconds(t), mesh.getPoints().size());
+
+    t = std::chrono::steady_clock::now();
+    mesh.build(a.build);
+    std::fprintf(stderr, "build  %9.3fs  %zu triangles\n", seconds(t), mesh.getTriangles().size());
+    if (!mesh.isValid()) {
+        std::fprintf(stderr, "verification failed\n");
+        return 1;
+    }
+
+    const auto& edges = mesh.getEdges();
+    std::vector<int> color;
+    if (!a.color.empty()) {
+        t = std::chrono::steady_clock::now();
+        const dsatur::Graph G(mesh.getPoints().size(), edges, mesh.getTriangles());
+        if (a.color == "point") color = dsatur::color_point(G, a.coloring);
+        else if (a.color == "edge") color = dsatur::color_edge(G, a.coloring);
+        else color = dsatur::color_face(G, a.coloring);
+        const int k = color.empty() ? 0 : *std::max_element(color.begin(), color.end()) + 1;
+        std::fprintf(stderr, "color  %9.3fs  %d colors\n", seconds(t), k);
+    }
+
+    bool ok = true;
+    if (a.edges == nullptr && a.triangles == nullptr && a.colors == nullptr) a.edges = "-";
+    if (a.edges != nullptr) {
+        ok &= write(a.edges, [&](io::Writer& w) {
+            if (a.binary) io::write_edges_binary(w, edges);
+            else io::write_edges_text(w, mesh.getPoints().size(), edges);
+        });
+    }
+    if (a.triangles != nullptr) {
+        ok &= write(a.triangles, [&](io::Writer& w) {
+            if (a.binary) io::write_triangles_binary(w, mesh.getTriangles());
+            else io::write_triangles_text(w, mesh.getTriangles());
+        });
+    }
+    if (a.colors != nullptr) {
+        ok &= write(a.colors, [&](io::Writer& w) {
+            w.number(color.size());
+            w.put('\n');
+            for (const int c : color) {
+                w.number(c);
+                w.put('\n');
+            }
+        });
+    }
+    return ok ? 0 : 1;
+}
\ No newline at end of file
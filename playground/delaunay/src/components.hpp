@@ -1,7 +1,11 @@
 #pragma once
+#include "predicates.hpp"
+#include "stats.hpp"
 #include <vector>
 #include <cmath>
 #include <cassert>
+#include <cstdint>
+#include <type_traits>
 
 constexpr double EPS = 1e-12;
 
@@ -13,18 +17,36 @@ struct Node {
     Node operator-(const Node& a) const {return Node(x - a.x, y - a.y);}
     Node operator*(const double d) const {return Node(x * d, y * d);}
     Node operator/(const double d) const {assert(std::abs(d) > EPS); return Node(x / d, y / d);}
-    bool operator==(const Node& a) const {return std::hypot(x - a.x, y - a.y) < EPS;}
+    bool operator==(const Node& a) const {return x == a.x && y == a.y;}
     bool operator<(const Node& a) const {return x == a.x ? y < a.y : x < a.x;}
 
     friend Node operator*(const double d, const Node& a) {return Node(a.x * d, a.y * d);}
 };
 
+template <class S>
+struct Point {
+    static_assert(std::is_same_v<S, float> || std::is_same_v<S, double> ||
+                  std::is_same_v<S, int32_t> || std::is_same_v<S, uint32_t>,
+                  "coordinates must be float, double, int32_t or uint32_t");
+    S x{}, y{};
+    Point() = default;
+    Point(const S _x, const S _y) : x(_x), y(_y) {}
+    operator Node() const {return Node(x, y);}
+    bool operator==(const Point& a) const {return x == a.x && y == a.y;}
+    bool operator<(const Point& a) const {return x == a.x ? y < a.y : x < a.x;}
+};
+
 inline double dot(const Node& a, const Node& b) {return a.x * b.x + a.y * b.y;}
 inline double cross(const Node& a, const Node& b) {return a.x * b.y - a.y * b.x;}
-inline bool cw_orient(const Node&a, const Node& b, const Node& c) {return cross(b - a, c - a) < 0;}
-inline bool ccw_orient(const Node&a, const Node& b, const Node& c) {return cross(b - a, c - a) > 0;}
+inline double orient(const Node& a, const Node& b, const Node& c) {
+    stats::count(&stats::Counters::orient);
+    return predicates::orient2d(a.x, a.y, b.x, b.y, c.x, c.y);
+}
+inline bool cw_orient(const Node&a, const Node& b, const Node& c) {return orient(a, b, c) < 0;}
+inline bool ccw_orient(const Node&a, const Node& b, const Node& c) {return orient(a, b, c) > 0;}
 inline bool in_circle(const Node& a, const Node& b, const Node& c, const Node& p) {
-    return dot(a - p, a - p)*cross(b - p, c - p) + dot(b - p, b - p)*cross(c - p, a - p) + dot(c - p, c - p)*cross(a - p, b - p) > 0;
+    stats::count(&stats::Counters::in_circle);
+    return predicates::incircle(a.x, a.y, b.x, b.y, c.x, c.y, p.x, p.y) > 0;
 }
 
 struct Edge {
@@ -1,214 +1,975 @@
 #pragma once
 #include "components.hpp"
+#include "parallel.hpp"
+#include "stats.hpp"
 #include <vector>
-#include <list>
-#include <unordered_map>
 #include <tuple>
 #include <algorithm>
 #include <cmath>
 #include <cassert>
 #include <numeric>
 #include <cstdint>
+#include <random>
+#include <atomic>
+#include <span>
+#include <array>
 
 namespace delaunay {
 
-class DelaunayTriangulation {
-    static inline uint64_t eidx(const uint32_t from, const uint32_t to) {
-        return ((uint64_t)from << 32) | to;
-    }
-    Triangle make_triangle(uint32_t u, uint32_t v, uint32_t w) {
-        if (!ccw_orient(points[u], points[v], points[w])) std::swap(u, v);
-        return Triangle(u, v, w);
-    }
+enum class InsertionOrder {
+    // Sweeps in x order. Inputs that make the sweep flip far more than usual, such as
+    // lattices or long columns of equal x, are detected and rebuilt in Hilbert order.
+    Sweep,
+    // Inserts in BRIO rounds along a Hilbert curve. With threads > 1 every x strip is
+    // built this way and the strips are stitched as for Sweep.
+    Hilbert
+};
+
+struct BuildOptions {
+    uint32_t threads = 1;
+    InsertionOrder order = InsertionOrder::Sweep;
+    bool verify = false;
+};
+
+template <class Scalar = double>
+class BasicTriangulation {
 public:
-    uint32_t addPoint(double x, double y) {
+    using Coord = Point<Scalar>;
+    static constexpr uint32_t NONE = UINT32_MAX;
+    uint32_t addPoint(const Scalar x, const Scalar y) {
         up_to_date = false;
+        version++;
         points.emplace_back(x, y);
         return (uint32_t)points.size() - 1;
     }
+    void addPoints(std::span<const Scalar> xy) {
+        up_to_date = false;
+        version++;
+        points.reserve(points.size() + xy.size() / 2);
+        for (size_t i{}; i + 1 < xy.size(); i += 2) points.emplace_back(xy[i], xy[i + 1]);
+    }
+    void reserve(const size_t n) {points.reserve(n);}
+    uint32_t insertPoint(const Scalar x, const Scalar y) {
+        if (!up_to_date || triangles.empty()) {
+            const uint32_t p = addPoint(x, y);
+            rebuild();
+            return p;
+        }
+        stats::Timer timer(counters.seconds[stats::Insert]);
+        stats::Probe probe(counters);
+        const uint32_t p = points.size();
+        version++;
+        points.emplace_back(x, y);
+        canonical.emplace_back(p);
+        dup_next.emplace_back(NONE);
+        hull_next.resize(points.size(), NONE);
+        hull_prev.resize(points.size(), NONE);
+        hull_tri.resize(points.size(), NONE);
+        if (triangles.size() > 8 * grid.size()) buildIndex();
+        const uint32_t c = cell(at(p));
+        track = true;
+        changed.clear();
+        grid[c] = insert(p, hint(at(p)));
+        track = false;
+        std::sort(changed.begin(), changed.end());
+        changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+        return p;
+    }
+    void removePoint(const uint32_t id) {
+        if (id >= points.size() || (id < canonical.size() && canonical[id] == NONE)) return;
+        if (!up_to_date || triangles.empty()) {
+            canonical.resize(points.size(), 0);
+            canonical[id] = NONE;
+            rebuild();
+            return;
+        }
+        stats::Timer timer(counters.seconds[stats::Insert]);
+        stats::Probe probe(counters);
+        version++;
+        track = true;
+        changed.clear();
+        const bool local = detach(id);
+        track = false;
+        if (!local) {
+            canonical[id] = NONE;
+            rebuild();
+            return;
+        }
+        settle();
+    }
+    void movePoint(const uint32_t id, const Scalar x, const Scalar y) {
+        if (id >= points.size() || (id < canonical.size() && canonical[id] == NONE)) return;
+        if (!up_to_date || triangles.empty()) {
+            points[id] = Coord(x, y);
+            rebuild();
+            return;
+        }
+        stats::Timer timer(counters.seconds[stats::Insert]);
+        stats::Probe probe(counters);
+        version++;
+        track = true;
+        changed.clear();
+        const bool local = detach(id);
+        points[id] = Coord(x, y);
+        if (local) {
+            canonical[id] = id;
+            const uint32_t c = cell(at(id));
+            grid[c] = insert(id, hint(at(id)));
+        }
+        track = false;
+        if (!local) {
+            rebuild();
+            return;
+        }
+        settle();
+    }
     void clear() {
         points.clear();
+        canonical.clear();
         triangles.clear();
-        hull.clear();
-        hull_id.clear();
+        halfedges.clear();
+        hull_next.clear();
+        hull_prev.clear();
+        hull_tri.clear();
+        dup_next.clear();
+        grid.clear();
+        changed.clear();
         up_to_date = false;
+        version++;
+        counters = {};
+        valid = true;
     }
-    void build() {
+    void build(const BuildOptions& opt = {}) {
         if (up_to_date) return;
         up_to_date = true;
-        std::sort(points.begin(), points.end());
-        points.erase(std::unique(points.begin(), points.end()), points.end());
-        if ((int)points.size() < 3) return;
-        triangles.clear();
-        hull.clear();
-        hull_id.clear();
-        uint32_t N = points.size();
-        std::vector<uint32_t> ord(N);
-        std::iota(ord.begin(), ord.end(), 0);
-        std::sort(ord.begin(), ord.end(), [&](uint32_t i, uint32_t j) {return points[i] < points[j];});
-        initHull(ord[0], ord[1], ord[2]);
-        for (uint32_t i{3}; i < N; i++) {
-            expandHull(ord[i]);
-            LawsonLegalization();
-        }
-        check_graph();
+        options = opt;
+        version++;
+        changed.clear();
+        counters = {};
+        stats::Probe probe(counters);
+        const uint32_t old = canonical.size();
+        canonical.resize(points.size());
+        dup_next.assign(points.size(), NONE);
+        std::vector<uint32_t> ord;
+        ord.reserve(points.size());
+        for (uint32_t i{}; i < (uint32_t)points.size(); i++) {
+            if (i < old && canonical[i] == NONE) continue;
+            canonical[i] = i;
+            ord.emplace_back(i);
+        }
+        const uint32_t N = ord.size();
+        const uint32_t K = std::min<uint64_t>(4ull*opt.threads, N / MIN_STRIP);
+        const bool hilbert = opt.order == InsertionOrder::Hilbert;
+        bool brio = hilbert;
+        if (opt.threads > 1 && K > 1) {
+            brio = buildParallel(ord, opt.threads, K, hilbert);
+        }
+        else {
+            {
+                stats::Timer timer(counters.seconds[stats::Sort]);
+                std::sort(ord.begin(), ord.end(), [&](uint32_t i, uint32_t j) {return before(i, j);});
+                dedup(ord);
+            }
+            stats::Timer timer(counters.seconds[stats::Triangulate]);
+            if (brio || !sweep(ord)) {
+                insertBrio(ord);
+                brio = true;
+            }
+        }
+        {
+            stats::Timer timer(counters.seconds[stats::Index]);
+            if (brio) relayout();
+            buildIndex();
+        }
+        if (opt.verify || CHECKED) {
+            stats::Timer timer(counters.seconds[stats::Verify]);
+            valid = verify(opt.threads);
+            assert(valid);
+        }
     }
     const std::vector<Triangle>& getTriangles() const {return triangles;}
-    const std::vector<Node>& getPoints() const {return points;}
-    std::vector<std::pair<int,int>> getEdges() const {
-        std::vector<std::pair<int,int>> edges;
-        for (const auto& tri : triangles) {
-            for (uint32_t i{}; i < 3; i++) {
-                edges.emplace_back(std::minmax(tri.p[i%3], tri.p[(i+1)%3]));
+    const std::vector<Coord>& getPoints() const {return points;}
+    const std::vector<uint32_t>& getCanonical() const {return canonical;}
+    uint32_t locate(double x, double y) const {
+        if (triangles.empty()) return NONE;
+        const Node q(x, y);
+        const auto [t, inside] = walk(q, hint(q));
+        return inside ? t : NONE;
+    }
+    uint32_t nearest(double x, double y) const {
+        const Node q(x, y);
+        const auto dist = [&](const uint32_t v) {return dot(at(v) - q, at(v) - q);};
+        if (triangles.empty()) {
+            uint32_t v = NONE;
+            for (uint32_t i{}; i < (uint32_t)points.size(); i++) {
+                if (i < canonical.size() && canonical[i] == NONE) continue;
+                if (v == NONE || dist(i) < dist(v)) v = i;
             }
+            return v < canonical.size() ? canonical[v] : v;
+        }
+        const auto [r, inside] = walk(q, hint(q));
+        uint32_t e = inside ? 3*r : r;
+        if (inside) {
+            for (const uint32_t g : {3*r + 1, 3*r + 2}) {
+                if (dist(from(g)) < dist(from(e))) e = g;
+            }
+        }
+        uint32_t v = from(e);
+        double d = dist(v);
+        while (true) {
+            uint32_t be = e, bv = v;
+            const auto visit = [&](const uint32_t f) {
+                for (const uint32_t g : {next_he(f), prev_he(f)}) {
+                    const double dg = dist(from(g));
+                    if (dg < d) {bv = from(g); be = g; d = dg;}
+                }
+            };
+            uint32_t f = e;
+            do {
+                visit(f);
+                f = halfedges[prev_he(f)];
+            } while (f != NONE && f != e);
+            if (f == NONE) {
+                for (f = halfedges[e]; f != NONE; f = halfedges[f]) {
+                    f = next_he(f);
+                    visit(f);
+                }
+            }
+            if (bv == v) return v;
+            v = bv;
+            e = be;
+        }
+    }
+    std::vector<uint32_t> locate(const std::vector<Node>& qs, const uint32_t threads = 1) const {
+        return batch(qs, threads, [&](const Node& q) {return locate(q.x, q.y);});
+    }
+    std::vector<uint32_t> nearest(const std::vector<Node>& qs, const uint32_t threads = 1) const {
+        return batch(qs, threads, [&](const Node& q) {return nearest(q.x, q.y);});
+    }
+    const std::vector<std::pair<int,int>>& getEdges() const {
+        if (edges_version == version) return edges;
+        edges.clear();
+        edge_he.clear();
+        edges.reserve(halfedges.size() / 2 + 1);
+        edge_he.reserve(halfedges.size() / 2 + 1);
+        for (uint32_t e{}; e < (uint32_t)halfedges.size(); e++) {
+            if (halfedges[e] != NONE && halfedges[e] < e) continue;
+            edges.emplace_back(std::minmax(from(e), to(e)));
+            edge_he.emplace_back(e);
         }
-        std::sort(edges.begin(), edges.end());
-        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+        edges_version = version;
         return edges;
     }
+    const std::vector<uint32_t>& getEdgeHalfedges() const {
+        getEdges();
+        return edge_he;
+    }
+    const std::vector<uint32_t>& getHalfedges() const {return halfedges;}
+    uint32_t getNeighbor(const uint32_t t, const uint32_t i) const {
+        const uint32_t h = halfedges[3*t + i];
+        return h == NONE ? NONE : h / 3;
+    }
+    const std::vector<uint32_t>& getChangedTriangles() const {return changed;}
+    uint64_t getVersion() const {return version;}
+    uint64_t getFlips() const {return counters.flips;}
+    const stats::Counters& getStats() const {return counters;}
+    bool isValid() const {return valid;}
+    bool verify(const uint32_t threads = 1) const {
+        constexpr uint32_t BLOCK = 1 << 12;
+        const uint32_t N = points.size(), T = triangles.size();
+        if (halfedges.size() != 3ull*T || canonical.size() != N) return false;
+        std::atomic<bool> ok{true};
+        std::vector<uint32_t> hull((T + BLOCK - 1) / BLOCK, 0);
+        stats::Counters* const parent = stats::sink;
+        parallel::for_each(threads, hull.size(), [&](uint32_t k) {
+            stats::Probe probe(parent);
+            const uint32_t lo = k * BLOCK, hi = std::min<uint64_t>(T, lo + BLOCK);
+            bool good = true;
+            for (uint32_t t = lo; t < hi && good; t++) {
+                const auto [a, b, c] = triangles[t].p;
+                good = a < N && b < N && c < N && canonical[a] == a && canonical[b] == b && canonical[c] == c
+                    && ccw_orient(at(a), at(b), at(c));
+                for (uint32_t e = 3*t; e < 3*t + 3 && good; e++) {
+                    const uint32_t h = halfedges[e];
+                    if (h == NONE) {
+                        hull[k]++;
+                        good = convexAt(e) && hull_tri[from(e)] == e && hull_next[from(e)] == to(e);
+                        continue;
+                    }
+                    good = h < 3*T && halfedges[h] == e && from(h) == to(e) && to(h) == from(e);
+                    if (good && e < h) good = !in_circle(at(from(e)), at(to(e)), at(to(next_he(e))), at(to(next_he(h))));
+                }
+            }
+            if (!good) ok = false;
+        });
+        if (!ok) return false;
+        if (T == 0) return true;
+        std::vector<char> used(N, 0);
+        for (const auto& tri : triangles) {
+            for (auto v : tri.p) used[v] = 1;
+        }
+        uint64_t V{}, H{};
+        for (uint32_t i{}; i < N; i++) {
+            if (canonical[i] != i) continue;
+            if (!used[i]) return false;
+            V++;
+        }
+        for (auto h : hull) H += h;
+        return (3ull*T + H) % 2 == 0 && V + T + 1 == (3ull*T + H) / 2 + 2;
+    }
 private:
-    std::tuple<uint32_t, uint32_t, uint32_t> addTriangle(const uint32_t u, const uint32_t v, const uint32_t w) {
-        assert(std::max({u, v, w}) < (uint32_t)points.size());
-        Triangle tri = make_triangle(u, v, w);
-        triangles.emplace_back(tri);
-        return std::make_tuple(tri.p[0], tri.p[1], tri.p[2]);
-    }
-    void addHullEdge(const std::list<Edge>::iterator it, const uint32_t p) {
-        assert((int)hull.size() > 1);
-        auto [from, to] = *it;
-        auto nit = std::next(it);
-        if (nit == hull.end()) nit = hull.begin();
-        hull.erase(it);
-        hull_id.erase(eidx(from, to));
-        auto jt1 = hull_id.find(eidx(p, from));
-        if (jt1 != hull_id.end()) {
-            hull.erase(jt1->second);
-            hull_id.erase(jt1);
+    static constexpr uint32_t MIN_STRIP = 1 << 12;
+    static constexpr uint32_t SWEEP_FLIPS = 1 << 6;
+    static constexpr uint32_t SWEEP_WINDOW = 1 << 8;
+    static constexpr uint32_t MAX_STAR = 1 << 8;
+#ifdef NDEBUG
+    static constexpr bool CHECKED = false;
+#else
+    static constexpr bool CHECKED = true;
+#endif
+    static inline uint32_t next_he(const uint32_t e) {return e % 3 == 2 ? e - 2 : e + 1;}
+    static inline uint32_t prev_he(const uint32_t e) {return e % 3 == 0 ? e + 2 : e - 1;}
+    void link(const uint32_t a, const uint32_t b) {
+        halfedges[a] = b;
+        if (b != NONE) halfedges[b] = a;
+        else hull_tri[from(a)] = a;
+    }
+    uint32_t newTriangle() {
+        if constexpr (stats::enabled) {
+            counters.allocations += triangles.size() == triangles.capacity();
+            counters.allocations += halfedges.size() + 3 > halfedges.capacity();
         }
-        else {
-            auto it1 = hull.insert(nit, Edge(from, p));
-            hull_id[eidx(from, p)] = it1;
+        triangles.emplace_back(NONE, NONE, NONE);
+        halfedges.resize(3*triangles.size(), NONE);
+        return (uint32_t)triangles.size() - 1;
+    }
+    void setTriangle(const uint32_t t, const uint32_t u, const uint32_t v, const uint32_t w,
+                     const uint32_t hu, const uint32_t hv, const uint32_t hw) {
+        triangles[t] = Triangle(u, v, w);
+        link(3*t, hu);
+        link(3*t + 1, hv);
+        link(3*t + 2, hw);
+        if (track) changed.emplace_back(t);
+    }
+    std::pair<uint32_t, bool> walk(const Node& q, uint32_t t) const {
+        uint32_t i{}, k{};
+        while (k < 3) {
+            const auto& tri = triangles[t];
+            if (cw_orient(at(tri.p[i]), at(tri.p[(i+1)%3]), q)) {
+                const uint32_t h = halfedges[3*t + i];
+                if (h == NONE) return std::make_pair(3*t + i, false);
+                t = h / 3;
+                i = (h % 3 + 1) % 3;
+                k = 1;
+                continue;
+            }
+            i = (i + 1) % 3;
+            k++;
+        }
+        return std::make_pair(t, true);
+    }
+    uint32_t from(const uint32_t e) const {return triangles[e / 3].p[e % 3];}
+    uint32_t to(const uint32_t e) const {return triangles[e / 3].p[(e + 1) % 3];}
+    Node at(const uint32_t v) const {return points[v];}
+    uint32_t hint(const Node& q) const {
+        const uint32_t t = grid[cell(q)];
+        return t < triangles.size() ? t : 0;
+    }
+    void rebuild() {
+        up_to_date = false;
+        build(options);
+        changed.resize(triangles.size());
+        std::iota(changed.begin(), changed.end(), 0);
+    }
+    void settle() {
+        const uint32_t T = triangles.size();
+        changed.erase(std::remove_if(changed.begin(), changed.end(), [&](const uint32_t t) {return t >= T;}), changed.end());
+        std::sort(changed.begin(), changed.end());
+        changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+    }
+    std::vector<uint32_t> star(const uint32_t p) const {
+        const auto [r, inside] = walk(at(p), hint(at(p)));
+        const uint32_t t = inside ? r : r / 3;
+        uint32_t e = NONE;
+        for (uint32_t k{}; k < 3; k++) {
+            if (triangles[t].p[k] == p) e = 3*t + k;
+        }
+        if (e == NONE) return {};
+        for (uint32_t f = e, e0 = e; halfedges[f] != NONE;) {
+            f = next_he(halfedges[f]);
+            if (f == e0) break;
+            e = f;
+        }
+        std::vector<uint32_t> fan;
+        uint32_t f = e;
+        do {
+            fan.emplace_back(f);
+            f = halfedges[prev_he(f)];
+        } while (f != NONE && f != e);
+        return fan;
+    }
+    bool detach(const uint32_t p) {
+        if (canonical[p] != p) {
+            uint32_t v = canonical[p];
+            while (dup_next[v] != p) v = dup_next[v];
+            dup_next[v] = dup_next[p];
+            dup_next[p] = NONE;
+            canonical[p] = NONE;
+            return true;
+        }
+        const auto fan = star(p);
+        if (fan.empty()) return false;
+        const bool open = halfedges[fan[0]] == NONE;
+        if (dup_next[p] != NONE) {
+            uint32_t q = dup_next[p];
+            for (uint32_t v = q; v != NONE; v = dup_next[v]) q = std::min(q, v);
+            uint32_t rest = NONE;
+            for (uint32_t v = dup_next[p]; v != NONE;) {
+                const uint32_t w = dup_next[v];
+                if (v != q) {
+                    canonical[v] = q;
+                    dup_next[v] = rest;
+                    rest = v;
+                }
+                v = w;
+            }
+            canonical[q] = q;
+            dup_next[q] = rest;
+            for (auto e : fan) {
+                triangles[e / 3].p[e % 3] = q;
+                if (track) changed.emplace_back(e / 3);
+            }
+            if (open) {
+                hull_next[q] = hull_next[p]; hull_prev[q] = hull_prev[p]; hull_tri[q] = hull_tri[p];
+                hull_prev[hull_next[p]] = q; hull_next[hull_prev[p]] = q;
+            }
+            hull_next[p] = hull_prev[p] = hull_tri[p] = NONE;
+            canonical[p] = NONE;
+            dup_next[p] = NONE;
+            return true;
+        }
+        if (fan.size() > MAX_STAR || (!open && fan.size() < 3)) return false;
+
+        std::vector<uint32_t> poly, outer;
+        for (auto e : fan) {
+            poly.emplace_back(to(e));
+            outer.emplace_back(halfedges[next_he(e)]);
+        }
+        if (open) poly.emplace_back(to(next_he(fan.back())));
+        const std::vector<uint32_t> ring = poly;
+        const auto ear = [&](const uint32_t a, const uint32_t b, const uint32_t c) {
+            if (!ccw_orient(at(a), at(b), at(c))) return false;
+            for (auto v : ring) {
+                if (v != a && v != b && v != c && in_circle(at(a), at(b), at(c), at(v))) return false;
+            }
+            return true;
+        };
+        std::vector<std::array<uint32_t, 6>> plan;
+        const auto cut = [&](const uint32_t i) {
+            const uint32_t n = poly.size(), j = (i + 1) % n, k = (i + 2) % n;
+            const uint32_t t = fan[plan.size()] / 3;
+            plan.push_back({poly[i], poly[j], poly[k], outer[i], outer[j], 3*t + 2});
+            outer[i] = 3*t + 2;
+            poly.erase(poly.begin() + j);
+            outer.erase(outer.begin() + j);
+        };
+        while (poly.size() > 3 || (open && poly.size() > 2)) {
+            const uint32_t n = poly.size(), m = open ? n - 2 : n;
+            uint32_t i{};
+            while (i < m && !ear(poly[i], poly[(i + 1) % n], poly[(i + 2) % n])) i++;
+            if (i == m) break;
+            cut(i);
         }
-        auto jt2 = hull_id.find(eidx(to, p));
-        if (jt2 != hull_id.end()) {
-            hull.erase(jt2->second);
-            hull_id.erase(jt2);
+        if (open) {
+            for (uint32_t i{}; i + 2 < poly.size(); i++) {
+                if (ccw_orient(at(poly[i]), at(poly[i + 1]), at(poly[i + 2]))) return false;
+            }
+            for (auto h : outer) {
+                if (h == NONE) return false;
+            }
+            if (plan.empty() && triangles.size() == fan.size()) return false;
         }
         else {
-            auto it2 = hull.insert(nit, Edge(p, to));
-            hull_id[eidx(p, to)] = it2;
+            if (poly.size() != 3 || !ccw_orient(at(poly[0]), at(poly[1]), at(poly[2]))) return false;
+            plan.push_back({poly[0], poly[1], poly[2], outer[0], outer[1], outer[2]});
+        }
+
+        for (uint32_t j{}; j < (uint32_t)plan.size(); j++) {
+            const auto [a, b, c, hab, hbc, hca] = plan[j];
+            const uint32_t t = fan[j] / 3;
+            triangles[t] = Triangle(a, b, c);
+            link(3*t, hab);
+            link(3*t + 1, hbc);
+            if (hca != 3*t + 2) link(3*t + 2, hca);
+            else halfedges[3*t + 2] = NONE;
+            if (track) changed.emplace_back(t);
         }
+        if (open) {
+            for (uint32_t i{}; i + 1 < poly.size(); i++) {
+                halfedges[outer[i]] = NONE;
+                hull_tri[poly[i + 1]] = outer[i];
+                hull_next[poly[i + 1]] = poly[i];
+                hull_prev[poly[i]] = poly[i + 1];
+            }
+        }
+        hull_next[p] = hull_prev[p] = hull_tri[p] = NONE;
+        canonical[p] = NONE;
+        std::vector<uint32_t> freed;
+        for (uint32_t j = plan.size(); j < (uint32_t)fan.size(); j++) freed.emplace_back(fan[j] / 3);
+        release(std::move(freed));
+        grid[cell(at(p))] = std::min<uint32_t>(fan[0] / 3, triangles.size() - 1);
+        return true;
     }
-    void initHull(const uint32_t i0, const uint32_t i1, const uint32_t i2) {
-        auto [p0, p1, p2] = addTriangle(i0, i1, i2);
-        auto e0 = hull.insert(hull.end(), Edge(p0, p1));
-        hull_id[eidx(p0, p1)] = e0;
-        auto e1 = hull.insert(hull.end(), Edge(p1, p2));
-        hull_id[eidx(p1, p2)] = e1;
-        auto e2 = hull.insert(hull.end(), Edge(p2, p0));
-        hull_id[eidx(p2, p0)] = e2;
+    void release(std::vector<uint32_t> slots) {
+        std::sort(slots.begin(), slots.end());
+        while (!slots.empty()) {
+            const uint32_t last = triangles.size() - 1;
+            if (slots.back() == last) slots.pop_back();
+            else {
+                moveTriangle(last, slots.front());
+                slots.erase(slots.begin());
+            }
+            triangles.pop_back();
+        }
+        halfedges.resize(3*triangles.size());
     }
-    void expandHull(const uint32_t p) {
-        if (hull.empty()) return;
-        const auto tmp = hull;
-        for (auto [from, to] : tmp) {
-            auto it = hull_id.find(eidx(from, to));
-            if (it == hull_id.end()) continue;
-            if (cw_orient(points[from], points[to], points[p])) {
-                addHullEdge(it->second, p); addTriangle(from, to, p);
+    void moveTriangle(const uint32_t from_t, const uint32_t to_t) {
+        triangles[to_t] = triangles[from_t];
+        for (uint32_t k{}; k < 3; k++) {
+            const uint32_t h = halfedges[3*from_t + k];
+            halfedges[3*to_t + k] = h;
+            if (h != NONE) halfedges[h] = 3*to_t + k;
+            else hull_tri[triangles[to_t].p[k]] = 3*to_t + k;
+        }
+        if (track) changed.emplace_back(to_t);
+    }
+    uint32_t insert(const uint32_t p, const uint32_t start) {
+        const auto [idx, inside] = walk(at(p), start);
+        if (!inside) {
+            attachOutside(p, idx);
+            return idx / 3;
+        }
+        const auto& tri = triangles[idx];
+        for (auto v : tri.p) {
+            if (points[v] == points[p]) {
+                canonical[p] = v;
+                dup_next[p] = dup_next[v];
+                dup_next[v] = p;
+                return idx;
             }
         }
+        for (uint32_t i{}; i < 3; i++) {
+            const Node a = at(tri.p[i]);
+            const Node b = at(tri.p[(i+1)%3]);
+            if (!cw_orient(a, b, at(p)) && !ccw_orient(a, b, at(p))) {
+                splitEdge(3*idx + i, p);
+                return idx;
+            }
+        }
+        splitTriangle(idx, p);
+        return idx;
     }
-    void LawsonLegalization() {
-        const auto e_id = [&](uint32_t u, uint32_t v) -> uint64_t {
-            return eidx(std::min(u, v), std::max(u, v));
-        };
-        const auto unpack = [](uint64_t id) -> std::pair<uint32_t, uint32_t> {
-            return std::make_pair(id >> 32, id & 0xffffffffu);
-        };
-        std::unordered_map<uint64_t, std::pair<int, int>> e_to_t;
-        auto tag = [&](uint64_t key, uint32_t t) {
-            if (!e_to_t.count(key)) e_to_t[key] = std::make_pair(-1, -1);
-            (e_to_t[key].first == -1 ? e_to_t[key].first : e_to_t[key].second) = t;
-        };
-        auto detag = [&](uint64_t key, uint32_t t) {
-            auto it = e_to_t.find(key);
-            if (it == e_to_t.end()) return;
-            auto& ts = it->second;
-            if (ts.first == t) ts.first = -1;
-            if (ts.second == t) ts.second = -1;
-            if (ts.first == -1 && ts.second == -1) e_to_t.erase(it);
-        };
+    void splitTriangle(const uint32_t t, const uint32_t p) {
+        const auto [a, b, c] = triangles[t].p;
+        const uint32_t ha = halfedges[3*t], hb = halfedges[3*t + 1], hc = halfedges[3*t + 2];
+        const uint32_t t1 = newTriangle(), t2 = newTriangle();
+        setTriangle(t, a, b, p, ha, 3*t1 + 2, 3*t2 + 1);
+        setTriangle(t1, b, c, p, hb, 3*t2 + 2, 3*t + 1);
+        setTriangle(t2, c, a, p, hc, 3*t + 2, 3*t1 + 1);
+        legalize({3*t, 3*t1, 3*t2});
+    }
+    void splitEdge(const uint32_t e, const uint32_t p) {
+        const uint32_t t = e / 3, h = halfedges[e];
+        const uint32_t a = from(e), b = to(e), c = to(next_he(e));
+        const uint32_t hbc = halfedges[next_he(e)], hca = halfedges[prev_he(e)];
+        const uint32_t t1 = newTriangle();
+        if (h == NONE) {
+            setTriangle(t, c, a, p, hca, NONE, 3*t1 + 1);
+            setTriangle(t1, b, c, p, hbc, 3*t + 2, NONE);
+            hull_next[a] = p; hull_prev[p] = a;
+            hull_next[p] = b; hull_prev[b] = p;
+            legalize({3*t, 3*t1});
+            return;
+        }
+        const uint32_t s = h / 3, d = to(next_he(h));
+        const uint32_t had = halfedges[next_he(h)], hdb = halfedges[prev_he(h)];
+        const uint32_t s1 = newTriangle();
+        setTriangle(t, c, a, p, hca, 3*s + 2, 3*t1 + 1);
+        setTriangle(t1, b, c, p, hbc, 3*t + 2, 3*s1 + 1);
+        setTriangle(s, a, d, p, had, 3*s1 + 2, 3*t + 1);
+        setTriangle(s1, d, b, p, hdb, 3*t1 + 2, 3*s + 1);
+        legalize({3*t, 3*t1, 3*s, 3*s1});
+    }
+    void attachOutside(const uint32_t p, const uint32_t e) {
+        uint32_t v0 = from(e), vm = to(e);
+        while (cw_orient(at(hull_prev[v0]), at(v0), at(p))) v0 = hull_prev[v0];
+        while (cw_orient(at(vm), at(hull_next[vm]), at(p))) vm = hull_next[vm];
+        std::vector<uint32_t> st;
+        uint32_t left = NONE;
+        for (uint32_t v = v0; v != vm; v = hull_next[v]) {
+            const uint32_t x = hull_tri[v], t = newTriangle();
+            setTriangle(t, hull_next[v], v, p, x, left, NONE);
+            left = 3*t + 2;
+            st.emplace_back(3*t);
+        }
+        hull_next[v0] = p; hull_prev[p] = v0;
+        hull_next[p] = vm; hull_prev[vm] = p;
+        legalize(std::move(st));
+    }
+    void legalize(std::vector<uint32_t> st, const bool all_sides = false) {
+        while (!st.empty()) {
+            const uint32_t e = st.back(); st.pop_back();
+            const uint32_t h = halfedges[e];
+            if (h == NONE) continue;
+            const uint32_t t0 = e / 3, t1 = h / 3;
+            const uint32_t a = from(e), b = to(e), c = to(next_he(e)), d = to(next_he(h));
+            if (!in_circle(at(a), at(b), at(c), at(d))) continue;
+            const uint32_t hbc = halfedges[next_he(e)], hca = halfedges[prev_he(e)];
+            const uint32_t had = halfedges[next_he(h)], hdb = halfedges[prev_he(h)];
+            counters.flips++;
+            setTriangle(t0, a, d, c, had, 3*t1 + 1, hca);
+            setTriangle(t1, b, c, d, hbc, 3*t0 + 1, hdb);
+            st.insert(st.end(), {3*t0, 3*t1 + 2});
+            if (all_sides) st.insert(st.end(), {3*t0 + 2, 3*t1});
+        }
+    }
+    uint32_t initHull(const std::vector<uint32_t>& ord) {
+        const uint32_t N = ord.size();
+        const Node a = at(ord[0]);
+        const Node b = at(ord[1]);
+        uint32_t k{2};
+        while (k < N && orient(a, b, at(ord[k])) == 0) k++;
+        if (k == N) return N;
+        const uint32_t p = ord[k];
+        const bool left = ccw_orient(a, b, at(p));
+        for (uint32_t i{}; i + 1 < k; i++) {
+            const uint32_t t = newTriangle();
+            if (left) setTriangle(t, ord[i], ord[i+1], p, NONE, NONE, i ? 3*t - 2 : NONE);
+            else setTriangle(t, ord[i+1], ord[i], p, NONE, i ? 3*t - 1 : NONE, NONE);
+            if (left) {hull_next[ord[i]] = ord[i+1]; hull_prev[ord[i+1]] = ord[i];}
+            else {hull_next[ord[i+1]] = ord[i]; hull_prev[ord[i]] = ord[i+1];}
+        }
+        const uint32_t first = left ? ord[0] : ord[k-1], last = left ? ord[k-1] : ord[0];
+        hull_next[last] = p; hull_prev[p] = last;
+        hull_next[p] = first; hull_prev[first] = p;
+        return k + 1;
+    }
+    void expandHull(const uint32_t p, const uint32_t q) {
+        uint32_t e = hull_tri[q];
+        if (!cw_orient(at(from(e)), at(to(e)), at(p))) e = hull_tri[hull_prev[q]];
+        attachOutside(p, e);
+    }
+    template <class F>
+    std::vector<uint32_t> batch(const std::vector<Node>& qs, const uint32_t threads, F&& f) const {
+        constexpr uint32_t BLOCK = 1 << 12;
+        std::vector<uint32_t> res(qs.size());
+        parallel::for_each(threads, (qs.size() + BLOCK - 1) / BLOCK, [&](uint32_t b) {
+            const uint32_t lo = b * BLOCK, hi = std::min<uint64_t>(qs.size(), lo + BLOCK);
+            for (uint32_t i = lo; i < hi; i++) res[i] = f(qs[i]);
+        });
+        return res;
+    }
+    std::pair<Node, Node> bounds() const {
+        Node lo = at(0), hi = at(0);
+        for (const Node p : points) {
+            lo.x = std::min(lo.x, p.x); hi.x = std::max(hi.x, p.x);
+            lo.y = std::min(lo.y, p.y); hi.y = std::max(hi.y, p.y);
+        }
+        return std::make_pair(lo, hi);
+    }
+    static uint32_t hilbert(uint32_t x, uint32_t y) {
+        uint32_t d{};
+        for (uint32_t s = 1u << 15; s > 0; s >>= 1) {
+            const uint32_t rx = (x & s) > 0, ry = (y & s) > 0;
+            d += s * s * ((3 * rx) ^ ry);
+            if (ry == 0) {
+                if (rx == 1) {x = ~x; y = ~y;}
+                std::swap(x, y);
+            }
+        }
+        return d;
+    }
+    auto hilbertKey() const {
+        const auto [lo, hi] = bounds();
+        const double sx = hi.x > lo.x ? 65535 / (hi.x - lo.x) : 0;
+        const double sy = hi.y > lo.y ? 65535 / (hi.y - lo.y) : 0;
+        return [=](const Node& p) {return hilbert((p.x - lo.x) * sx, (p.y - lo.y) * sy);};
+    }
+    void insertBrio(std::vector<uint32_t>& ord) {
+        const uint32_t N = ord.size();
+        triangles.clear();
+        halfedges.clear();
+        hull_next.assign(points.size(), NONE);
+        hull_prev.assign(points.size(), NONE);
+        hull_tri.assign(points.size(), NONE);
+        if (N < 3) return;
+        std::shuffle(ord.begin(), ord.end(), std::mt19937(N));
+        const auto key = hilbertKey();
+        std::vector<uint32_t> hk(points.size());
+        for (auto i : ord) hk[i] = key(at(i));
+        for (uint64_t lo{}, hi{1}; lo < N; lo = hi, hi = std::min<uint64_t>(N, 2*hi)) {
+            std::sort(ord.begin() + lo, ord.begin() + hi, [&](uint32_t i, uint32_t j) {return hk[i] < hk[j];});
+        }
+        uint32_t k{2};
+        while (k < N && orient(at(ord[0]), at(ord[1]), at(ord[k])) == 0) k++;
+        if (k == N) return;
+        std::swap(ord[2], ord[k]);
+        triangles.reserve(2*N);
+        halfedges.reserve(6*N);
+        uint32_t t{};
+        for (uint32_t i = initHull(ord); i < N; i++) t = insert(ord[i], t);
+    }
+    void relayout() {
+        const uint32_t T = triangles.size();
+        if (T == 0) return;
+        const auto key = hilbertKey();
+        std::vector<uint32_t> hk(T), perm(T), rank(T);
+        for (uint32_t t{}; t < T; t++) {
+            const auto [a, b, c] = triangles[t].p;
+            hk[t] = key((at(a) + at(b) + at(c)) / 3);
+        }
+        std::iota(perm.begin(), perm.end(), 0);
+        std::sort(perm.begin(), perm.end(), [&](uint32_t i, uint32_t j) {return hk[i] < hk[j];});
+        for (uint32_t i{}; i < T; i++) rank[perm[i]] = i;
+        const auto remap = [&](const uint32_t e) {return e == NONE ? NONE : 3*rank[e / 3] + e % 3;};
+        std::vector<Triangle> tris;
+        std::vector<uint32_t> hes(3*T);
+        tris.reserve(T);
+        for (uint32_t i{}; i < T; i++) {
+            tris.emplace_back(triangles[perm[i]]);
+            for (uint32_t j{}; j < 3; j++) hes[3*i + j] = remap(halfedges[3*perm[i] + j]);
+        }
+        for (auto& e : hull_tri) e = remap(e);
+        triangles.swap(tris);
+        halfedges.swap(hes);
+    }
+    void buildIndex() {
+        grid.clear();
+        if (triangles.empty()) return;
+        const auto [lo, hi] = bounds();
+        const double x0 = lo.x, y0 = lo.y, x1 = hi.x, y1 = hi.y;
+        const double n = std::max<double>(1, triangles.size() / 2);
+        grid_w = std::clamp<double>(std::sqrt(n * (x1 - x0) / (y1 - y0)), 1, n);
+        grid_h = std::max<double>(1, n / grid_w);
+        grid_x0 = x0; grid_sx = grid_w / (x1 - x0);
+        grid_y0 = y0; grid_sy = grid_h / (y1 - y0);
+        grid.assign((uint64_t)grid_w * grid_h, NONE);
         for (uint32_t t{}; t < (uint32_t)triangles.size(); t++) {
-            const auto& tri = triangles[t];
-            for (uint32_t i{}; i < 3; i++) {
-                tag(e_id(tri.p[i], tri.p[(i+1)%3]), t);
+            const auto [a, b, c] = triangles[t].p;
+            grid[cell((at(a) + at(b) + at(c)) / 3)] = t;
+        }
+        uint32_t last = *std::find_if(grid.begin(), grid.end(), [](uint32_t t) {return t != NONE;});
+        for (auto& t : grid) {
+            if (t == NONE) t = last;
+            else last = t;
+        }
+    }
+    uint32_t cell(const Node& q) const {
+        const auto clamp = [](const double v, const uint32_t n) {return (uint32_t)std::clamp(v, 0.0, n - 1.0);};
+        return clamp((q.y - grid_y0) * grid_sy, grid_h) * grid_w + clamp((q.x - grid_x0) * grid_sx, grid_w);
+    }
+    bool before(const uint32_t i, const uint32_t j) const {
+        return points[i] < points[j] || (points[i] == points[j] && i < j);
+    }
+    void dedup(std::vector<uint32_t>& ord) {
+        uint32_t m{};
+        for (auto i : ord) {
+            if (m > 0 && points[i] == points[ord[m-1]]) {
+                canonical[i] = ord[m-1];
+                dup_next[i] = dup_next[ord[m-1]];
+                dup_next[ord[m-1]] = i;
             }
+            else ord[m++] = i;
         }
-        std::vector<uint64_t> st;
-        for (auto& [e, ts] : e_to_t) {
-            if (ts.first == -1 || ts.second == -1) continue;
-            st.emplace_back(e);
+        ord.resize(m);
+    }
+    bool sweep(const std::vector<uint32_t>& ord) {
+        const uint32_t N = ord.size();
+        triangles.clear();
+        halfedges.clear();
+        hull_next.assign(points.size(), NONE);
+        hull_prev.assign(points.size(), NONE);
+        hull_tri.assign(points.size(), NONE);
+        if (N < 3) return true;
+        triangles.reserve(2*N);
+        halfedges.reserve(6*N);
+        uint64_t f0 = counters.flips;
+        for (uint32_t i = initHull(ord); i < N; i++) {
+            expandHull(ord[i], ord[i-1]);
+            if (i % SWEEP_WINDOW == 0) {
+                if (counters.flips - f0 > SWEEP_FLIPS * SWEEP_WINDOW) return false;
+                f0 = counters.flips;
+            }
         }
-        while (!st.empty()) {
-            uint64_t e = st.back(); st.pop_back();
-            auto it = e_to_t.find(e);
-            if (it == e_to_t.end()) continue;
-            auto [tl, tr] = e_to_t[e];
-            if (tl == -1 || tr == -1) continue;
-            auto [u, v] = unpack(e);
-            uint32_t wl = triangles[tl].opposite(u, v), wr = triangles[tr].opposite(u, v);
-            if (wl >= (uint32_t)points.size() || wr >= (uint32_t)points.size()) continue;
-            if (!ccw_orient(points[u], points[v], points[wl])) std::swap(u, v);
-            if (in_circle(points[u], points[v], points[wl], points[wr])) {
-                auto add_edge = [&](uint32_t t) {
-                    const auto& tri = triangles[t];
-                    for (uint32_t i{}; i < 3; i++) {
-                        tag(e_id(tri.p[i], tri.p[(i+1)%3]), t);
-                    }
-                };
-                auto remove_edge = [&](uint32_t t) {
-                    const auto& tri = triangles[t];
-                    for (uint32_t i{}; i < 3; i++) {
-                        detag(e_id(tri.p[i], tri.p[(i+1)%3]), t);
-                    }
-                };
-                remove_edge(tl);
-                remove_edge(tr);
-                triangles[tl] = make_triangle(wl, wr, u);
-                triangles[tr] = make_triangle(wl, wr, v);
-                add_edge(tl);
-                add_edge(tr);
-                
-                for (auto a : {u, v}) {
-                    for (auto b : {wl, wr}) {
-                        auto it = e_to_t.find(e_id(a, b));
-                        if (it == e_to_t.end()) continue;
-                        if (it->second.first == -1 || it->second.second == -1) continue;
-                        st.emplace_back(e_id(a, b));
-                    }
-                }
-                auto it = e_to_t.find(e_id(wl, wr));
-                if (it != e_to_t.end() && it->second.first != -1 && it->second.second != -1) {
-                    st.emplace_back(e_id(wl, wr));
-                }
+        return true;
+    }
+    bool buildParallel(std::vector<uint32_t>& ord, const uint32_t threads, uint32_t K, const bool hilbert) {
+        const auto less = [&](uint32_t i, uint32_t j) {return before(i, j);};
+        std::vector<uint32_t> cut(K + 1);
+        for (uint32_t k{}; k <= K; k++) cut[k] = (uint64_t)ord.size() * k / K;
+        {
+            stats::Timer timer(counters.seconds[stats::Sort]);
+            const auto partition = [&](auto&& self, const uint32_t lo, const uint32_t hi) -> void {
+                if (hi - lo < 2) return;
+                const uint32_t mid = (lo + hi) / 2;
+                std::nth_element(ord.begin() + cut[lo], ord.begin() + cut[mid], ord.begin() + cut[hi], less);
+                self(self, lo, mid);
+                self(self, mid, hi);
+            };
+            partition(partition, 0, K);
+            parallel::for_each(threads, K, [&](uint32_t k) {
+                std::sort(ord.begin() + cut[k], ord.begin() + cut[k+1], less);
+            });
+            dedup(ord);
+        }
+        stats::Timer timer(counters.seconds[stats::Triangulate]);
+        const uint32_t N = ord.size();
+        // A strip never ends inside a run of equal x and always spans two of them:
+        // stitching the two halves of a split column costs quadratically many flips.
+        const auto same_x = [&](const uint32_t i, const uint32_t j) {return points[ord[i]].x == points[ord[j]].x;};
+        cut.assign(1, 0);
+        for (uint32_t k{1}; k < K; k++) {
+            uint32_t c = std::max<uint64_t>((uint64_t)N * k / K, cut.back() + 1);
+            while (c < N && (same_x(c - 1, c) || same_x(cut.back(), c - 1))) c++;
+            if (c == N) break;
+            cut.push_back(c);
+        }
+        while (cut.size() > 1 && same_x(cut.back(), N - 1)) cut.pop_back();
+        cut.push_back(N);
+        K = cut.size() - 1;
+
+        std::vector<BasicTriangulation> strip(K);
+        std::vector<char> brio(K, hilbert);
+        parallel::for_each(threads, K, [&](uint32_t k) {
+            auto& S = strip[k];
+            stats::Probe probe(S.counters);
+            for (uint32_t i = cut[k]; i < cut[k+1]; i++) S.points.emplace_back(points[ord[i]]);
+            std::vector<uint32_t> local(S.points.size());
+            std::iota(local.begin(), local.end(), 0);
+            if (brio[k] || !S.sweep(local)) {
+                S.insertBrio(local);
+                brio[k] = true;
+            }
+        });
+        if (std::any_of(strip.begin(), strip.end(), [](const auto& S) {return S.triangles.empty();})) {
+            if (!hilbert && sweep(ord)) return false;
+            insertBrio(ord);
+            return true;
+        }
+        std::vector<uint32_t> offset(K + 1, 0);
+        for (uint32_t k{}; k < K; k++) offset[k+1] = offset[k] + strip[k].triangles.size();
+        for (const auto& S : strip) {
+            counters.orient += S.counters.orient;
+            counters.in_circle += S.counters.in_circle;
+            counters.flips += S.counters.flips;
+            counters.allocations += S.counters.allocations;
+        }
+        triangles.assign(offset[K], Triangle(NONE, NONE, NONE));
+        halfedges.assign(3*offset[K], NONE);
+        hull_next.assign(points.size(), NONE);
+        hull_prev.assign(points.size(), NONE);
+        hull_tri.assign(points.size(), NONE);
+        parallel::for_each(threads, K, [&](uint32_t k) {
+            auto& S = strip[k];
+            const uint32_t s = cut[k], h = 3*offset[k];
+            const auto id = [&](const uint32_t v) {return v == NONE ? NONE : ord[s + v];};
+            for (uint32_t t{}; t < (uint32_t)S.triangles.size(); t++) {
+                const auto& tri = S.triangles[t];
+                triangles[offset[k] + t] = Triangle(id(tri.p[0]), id(tri.p[1]), id(tri.p[2]));
+            }
+            for (uint32_t e{}; e < (uint32_t)S.halfedges.size(); e++) {
+                halfedges[h + e] = S.halfedges[e] == NONE ? NONE : S.halfedges[e] + h;
             }
+            for (uint32_t v{}; v < (uint32_t)S.points.size(); v++) {
+                hull_next[id(v)] = id(S.hull_next[v]);
+                hull_prev[id(v)] = id(S.hull_prev[v]);
+                hull_tri[id(v)] = S.hull_tri[v] == NONE ? NONE : S.hull_tri[v] + h;
+            }
+            S = BasicTriangulation();
+        });
+        for (uint32_t k{1}; k < K; k++) {
+            stitch(ord[cut[k] - 1], ord[cut[k]]);
         }
+        return std::find(brio.begin(), brio.end(), true) != brio.end();
     }
-    void check_graph() {
-        for (uint32_t i{}; i < (uint32_t)points.size(); i++) {
-            for (const auto& tri : triangles) {
-                if (i == tri.p[0] || i == tri.p[1] || i == tri.p[2]) continue;
-                assert(!in_circle(points[tri.p[0]], points[tri.p[1]], points[tri.p[2]], points[i]));
+    void stitch(const uint32_t lmax, const uint32_t rmin) {
+        const auto below = [&](const uint32_t a, const uint32_t b, const uint32_t c) {
+            if (cw_orient(at(a), at(b), at(c))) return true;
+            if (ccw_orient(at(a), at(b), at(c))) return false;
+            return dot(at(c) - at(a), at(b) - at(a)) > 0 && dot(at(c) - at(b), at(a) - at(b)) > 0;
+        };
+        uint32_t l_lo = lmax, r_lo = rmin, l_hi = lmax, r_hi = rmin;
+        while (true) {
+            if (below(l_lo, r_lo, hull_prev[l_lo])) l_lo = hull_prev[l_lo];
+            else if (below(l_lo, r_lo, hull_next[r_lo])) r_lo = hull_next[r_lo];
+            else break;
+        }
+        while (true) {
+            if (below(r_hi, l_hi, hull_next[l_hi])) l_hi = hull_next[l_hi];
+            else if (below(r_hi, l_hi, hull_prev[r_hi])) r_hi = hull_prev[r_hi];
+            else break;
+        }
+        uint32_t nl{}, nr{};
+        for (uint32_t v = l_lo; v != l_hi || nl == 0; v = hull_next[v]) nl++;
+        for (uint32_t v = r_lo; v != r_hi || nr == 0; v = hull_prev[v]) nr++;
+        const uint32_t keep = hull_tri[r_lo];
+        uint32_t le = hull_tri[l_lo];
+        uint32_t l = l_lo, r = r_lo, base = NONE;
+        std::vector<uint32_t> st;
+        while (nl > 0 || nr > 0) {
+            const uint32_t cl = nl > 0 ? hull_next[l] : NONE;
+            const uint32_t cr = nr > 0 ? hull_prev[r] : NONE;
+            const bool okl = cl != NONE && ccw_orient(at(l), at(r), at(cl));
+            const bool okr = cr != NONE && ccw_orient(at(l), at(r), at(cr));
+            const uint32_t t = newTriangle();
+            if (okl && okr ? in_circle(at(l), at(r), at(cr), at(cl)) : okl || cr == NONE) {
+                setTriangle(t, l, r, cl, base, NONE, le);
+                le = hull_tri[cl];
+                base = 3*t + 1; l = cl; nl--;
             }
+            else {
+                setTriangle(t, l, r, cr, base, hull_tri[cr], NONE);
+                base = 3*t + 2; r = cr; nr--;
+            }
+            st.insert(st.end(), {3*t, 3*t + 1, 3*t + 2});
+        }
+        if (r_lo != r_hi) hull_tri[r_lo] = keep;
+        hull_next[l_lo] = r_lo; hull_prev[r_lo] = l_lo;
+        hull_next[r_hi] = l_hi; hull_prev[l_hi] = r_hi;
+        legalize(std::move(st), true);
+    }
+    bool convexAt(const uint32_t e) const {
+        uint32_t f = next_he(e);
+        for (uint32_t n{}; halfedges[f] != NONE; n++) {
+            if (n > triangles.size() || halfedges[f] >= halfedges.size()) return false;
+            f = next_he(halfedges[f]);
         }
+        return orient(at(from(e)), at(to(e)), at(to(f))) >= 0;
     }
 private:
-    std::vector<Node> points;
+    std::vector<Coord> points;
+    std::vector<uint32_t> canonical;
     std::vector<Triangle> triangles;
-    std::list<Edge> hull;
-    std::unordered_map<uint64_t, std::list<Edge>::iterator> hull_id;
+    std::vector<uint32_t> halfedges;
+    std::vector<uint32_t> hull_next;
+    std::vector<uint32_t> hull_prev;
+    std::vector<uint32_t> hull_tri;
+    std::vector<uint32_t> dup_next;
+    std::vector<uint32_t> grid;
+    uint32_t grid_w{}, grid_h{};
+    double grid_x0{}, grid_y0{}, grid_sx{}, grid_sy{};
+    mutable std::vector<std::pair<int,int>> edges;
+    mutable std::vector<uint32_t> edge_he;
+    mutable uint64_t edges_version = UINT64_MAX;
+    std::vector<uint32_t> changed;
+    bool track = false;
+    uint64_t version = 0;
+    stats::Counters counters;
+    BuildOptions options;
     bool up_to_date = false;
+    bool valid = true;
 };
 
+using DelaunayTriangulation = BasicTriangulation<double>;
+
 }
\ No newline at end of file
@@ -1,156 +1,467 @@
 #pragma once
 #include "components.hpp"
+#include "parallel.hpp"
 #include <vector>
-#include <set>
-#include <queue>
+#include <algorithm>
+#include <cstdint>
+#include <bit>
+#include <atomic>
 #include <tuple>
 #include <string>
-#include <unordered_map>
-#include <boost/dynamic_bitset.hpp>
+#include <span>
 
 namespace dsatur {
-    std::vector<int> color_point(const std::vector<Node>& P, const std::vector<std::pair<int,int>> &E) {
-        const int N = P.size();
-        if (N < 3) return std::vector<int>(N, 0);
-        std::vector<std::vector<int>> G(N);
-        std::vector<int> deg(N, 0);
-        for (const auto& [u, v] : E) {
-            G[u].emplace_back(v);
-            G[v].emplace_back(u);
-            deg[u]++;
-            deg[v]++;
-        }
-        std::vector<int> color(N, -1), sat(N, 0);
-        std::vector<boost::dynamic_bitset<>> usd(N);
-        std::priority_queue<std::tuple<int,int,int>> que;
-        for (int i{}; i < N; i++) que.emplace(sat[i], deg[i], i);
-        for (int i{}; i < N; i++) {
-            int u = -1;
-            while (!que.empty()) {
-                auto [clrd, sz, cand] = que.top(); que.pop();
-                if (color[cand] != -1 || clrd != sat[cand]) continue;
-                u = cand;
-                break;
-            }
-            color[u] = 0;
-            while (color[u] < (int)usd[u].size() && usd[u].test(color[u])) color[u]++;
-            usd[u].resize(color[u] + 1);
-            for (auto v : G[u]) {
-                if (color[v] != -1) continue;
-                if ((int)usd[v].size() <= color[u]) {
-                    usd[v].resize(color[u] + 1);
+    enum class Engine {
+        DSatur,
+        JonesPlassmann,
+        SmallestLast
+    };
+
+    struct Options {
+        Engine engine = Engine::DSatur;
+        uint32_t threads = 1;
+        uint32_t refine = 0;
+        int kempe_limit = 0;
+    };
+
+    // E and T view the caller's edge and triangle lists, which must outlive the graph.
+    struct Graph {
+        int N{}, M{}, K{};
+        std::span<const std::pair<int,int>> E;
+        std::span<const Triangle> T;
+        std::vector<int> vo, adj, inc;
+        std::vector<int> fo, face;
+
+        Graph() = default;
+        Graph(const int n, std::span<const std::pair<int,int>> edges, std::span<const Triangle> tris)
+            : N(n), M(edges.size()), K(tris.size()), E(edges), T(tris) {
+            vo.assign(N + 1, 0);
+            fo.assign(N + 1, 0);
+            for (const auto& [u, v] : E) {
+                vo[u + 1]++;
+                vo[v + 1]++;
+            }
+            for (const auto& t : T) {
+                for (auto v : t.p) fo[v + 1]++;
+            }
+            for (int u{}; u < N; u++) {
+                vo[u + 1] += vo[u];
+                fo[u + 1] += fo[u];
+            }
+            adj.resize(2*M);
+            inc.resize(2*M);
+            face.resize(3*K);
+            std::vector<int> pos(vo.begin(), vo.end() - 1);
+            for (int i{}; i < M; i++) {
+                const auto& [u, v] = E[i];
+                adj[pos[u]] = v; inc[pos[u]++] = i;
+                adj[pos[v]] = u; inc[pos[v]++] = i;
+            }
+            pos.assign(fo.begin(), fo.end() - 1);
+            for (int i{}; i < K; i++) {
+                for (auto v : T[i].p) face[pos[v]++] = i;
+            }
+        }
+        int degree(const int u) const {return vo[u + 1] - vo[u];}
+        int faces(const int u) const {return fo[u + 1] - fo[u];}
+        template <class F>
+        void for_each_neighbor(const int u, F&& f) const {
+            for (int i = vo[u]; i < vo[u + 1]; i++) f(adj[i]);
+        }
+        template <class F>
+        void for_each_adjacent_edge(const int j, F&& f) const {
+            for (const int u : {E[j].first, E[j].second}) {
+                for (int i = vo[u]; i < vo[u + 1]; i++) {
+                    if (inc[i] != j) f(inc[i]);
                 }
-                if (usd[v].test(color[u])) continue;
-                usd[v].set(color[u]);
-                sat[v]++;
-                que.emplace(sat[v], deg[v], v);
             }
         }
+        template <class F>
+        void for_each_adjacent_face(const int j, F&& f) const {
+            for (const int u : T[j].p) {
+                for (int i = fo[u]; i < fo[u + 1]; i++) {
+                    if (face[i] != j) f(face[i]);
+                }
+            }
+        }
+    };
+
+    template <int W = 1>
+    class ColorSet {
+    public:
+        bool test(const int c) const {
+            if (c < 64*W) return mask[c / 64] >> (c % 64) & 1;
+            const size_t i = c / 64 - W;
+            return i < spill.size() && spill[i] >> (c % 64) & 1;
+        }
+        void set(const int c) {
+            if (c < 64*W) {
+                mask[c / 64] |= uint64_t{1} << (c % 64);
+                return;
+            }
+            const size_t i = c / 64 - W;
+            if (spill.size() <= i) spill.resize(i + 1, 0);
+            spill[i] |= uint64_t{1} << (c % 64);
+        }
+        int first_free() const {
+            for (int i{}; i < W; i++) {
+                if (~mask[i]) return 64*i + std::countr_one(mask[i]);
+            }
+            for (size_t i{}; i < spill.size(); i++) {
+                if (~spill[i]) return 64*(W + i) + std::countr_one(spill[i]);
+            }
+            return 64*(W + spill.size());
+        }
+    private:
+        uint64_t mask[W]{};
+        std::vector<uint64_t> spill;
+    };
+
+    class Kempe {
+    public:
+        template <class F>
+        int operator()(std::vector<int>& color, const int v, const int limit, F&& nbr) {
+            if (seen.size() < color.size()) seen.resize(color.size(), -1);
+            for (int a{}; a < limit; a++) {
+                for (int b = a + 1; b < limit; b++) {
+                    bool blocked = false;
+                    stamp++;
+                    st.clear();
+                    nbr(v, [&](const int u) {
+                        if (color[u] == a && seen[u] != stamp) {seen[u] = stamp; st.emplace_back(u);}
+                    });
+                    for (size_t k{}; k < st.size(); k++) {
+                        nbr(st[k], [&](const int u) {
+                            if (seen[u] == stamp || (color[u] != a && color[u] != b)) return;
+                            seen[u] = stamp;
+                            st.emplace_back(u);
+                        });
+                    }
+                    nbr(v, [&](const int u) {blocked |= color[u] == b && seen[u] == stamp;});
+                    if (blocked) continue;
+                    for (auto u : st) color[u] = color[u] == a ? b : a;
+                    return a;
+                }
+            }
+            return -1;
+        }
+    private:
+        std::vector<int> seen, st;
+        int stamp{};
+    };
+
+    class Queue {
+    public:
+        explicit Queue(const std::vector<int>& deg) : key(deg.size()), heap(deg.size()), pos(deg.size()) {
+            const int n = deg.size();
+            const auto [lo, hi] = std::minmax_element(deg.begin(), deg.end());
+            std::vector<int> cnt(*hi - *lo + 2, 0);
+            for (auto d : deg) cnt[d - *lo + 1]++;
+            for (int d{}; d + 1 < (int)cnt.size(); d++) cnt[d + 1] += cnt[d];
+            for (int i{}; i < n; i++) {
+                key[i] = cnt[deg[i] - *lo]++;
+                heap[n - 1 - key[i]] = i;
+                pos[i] = n - 1 - key[i];
+            }
+        }
+        bool empty() const {return heap.empty();}
+        int pop() {
+            const int top = heap[0];
+            heap[0] = heap.back();
+            pos[heap[0]] = 0;
+            heap.pop_back();
+            if (!heap.empty()) down(0);
+            return top;
+        }
+        void raise(const int i) {
+            key[i] += uint64_t{1} << 32;
+            up(pos[i]);
+        }
+    private:
+        void up(int k) {
+            const int i = heap[k];
+            while (k > 0 && key[heap[(k - 1) / 2]] < key[i]) {
+                heap[k] = heap[(k - 1) / 2];
+                pos[heap[k]] = k;
+                k = (k - 1) / 2;
+            }
+            heap[k] = i;
+            pos[i] = k;
+        }
+        void down(int k) {
+            const int n = heap.size(), i = heap[k];
+            while (2*k + 1 < n) {
+                int c = 2*k + 1;
+                if (c + 1 < n && key[heap[c]] < key[heap[c + 1]]) c++;
+                if (key[heap[c]] < key[i]) break;
+                heap[k] = heap[c];
+                pos[heap[k]] = k;
+                k = c;
+            }
+            heap[k] = i;
+            pos[i] = k;
+        }
+        std::vector<uint64_t> key;
+        std::vector<int> heap, pos;
+    };
+
+    template <class F>
+    std::vector<int> dsatur_color(const std::vector<int>& deg, F&& nbr) {
+        const int n = deg.size();
+        std::vector<int> color(n, -1);
+        if (n == 0) return color;
+        std::vector<ColorSet<>> usd(n);
+        Queue que(deg);
+        while (!que.empty()) {
+            const int u = que.pop();
+            color[u] = usd[u].first_free();
+            nbr(u, [&](const int v) {
+                if (color[v] != -1) return;
+                if (usd[v].test(color[u])) return;
+                usd[v].set(color[u]);
+                que.raise(v);
+            });
+        }
         return color;
     }
 
-    std::vector<int> color_edge(const std::vector<Node>& P, const std::vector<std::pair<int,int>> &E) {
-        const int N = P.size();
-        const int M = E.size();
-        if (N < 3) return std::vector<int>(M, 0);
-        std::vector<std::vector<int>> G(N);
-        std::vector<int> deg(N, 0);
-        for (int i{}; i < M; i++) {
-            const auto& [u, v] = E[i];
-            G[u].emplace_back(i);
-            G[v].emplace_back(i);
-            deg[u]++;
-            deg[v]++;
-        }
-        const auto edeg = [&](int i) {
-            return deg[E[i].first] + deg[E[i].second] - 2;
+    template <class F>
+    std::vector<int> jones_plassmann(const std::vector<int>& deg, const uint32_t threads, F&& nbr) {
+        constexpr int BLOCK = 1 << 10;
+        const int n = deg.size();
+        if (n == 0) return {};
+        const auto blocks = [](const int m) {return (m + BLOCK - 1) / BLOCK;};
+        const int lo = *std::min_element(deg.begin(), deg.end());
+        std::vector<uint64_t> prio(n);
+        for (int i{}; i < n; i++) {
+            uint64_t z = i + 0x9e3779b97f4a7c15ull;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            prio[i] = (uint64_t)(deg[i] - lo) << 32 | (uint32_t)(z ^ (z >> 31));
+        }
+        const auto higher = [&](const int a, const int b) {
+            return prio[a] != prio[b] ? prio[a] > prio[b] : a > b;
         };
-        std::vector<int> color(M, -1), sat(M, 0);
-        std::vector<boost::dynamic_bitset<>> usd(M);
-        std::priority_queue<std::tuple<int,int,int>> que;
-        for (int i{}; i < M; i++) que.emplace(sat[i], edeg(i), i);
-        for (int i{}; i < M; i++) {
-            int j = -1;
-            while (!que.empty()) {
-                auto [clrd, sz, cand] = que.top(); que.pop();
-                if (color[cand] != -1 || clrd != sat[cand]) continue;
-                j = cand;
-                break;
-            }
-            color[j] = 0;
-            while (color[j] < (int)usd[j].size() && usd[j].test(color[j])) color[j]++;
-            usd[j].resize(color[j] + 1);
-            for (auto k : G[E[j].first]) {
-                if (k == j || color[k] != -1) continue;
-                if ((int)usd[k].size() <= color[j]) {
-                    usd[k].resize(color[j] + 1);
-                }
-                if (usd[k].test(color[j])) continue;
-                usd[k].set(color[j]);
-                sat[k]++;
-                que.emplace(sat[k], edeg(k), k);
-            }
-            for (auto k : G[E[j].second]) {
-                if (k == j || color[k] != -1) continue;
-                if ((int)usd[k].size() <= color[j]) {
-                    usd[k].resize(color[j] + 1);
-                }
-                if (usd[k].test(color[j])) continue;
-                usd[k].set(color[j]);
-                sat[k]++;
-                que.emplace(sat[k], edeg(k), k);
+        std::vector<int> color(n, -1), frontier, next(n);
+        std::vector<std::atomic<int>> wait(n);
+        parallel::for_each(threads, blocks(n), [&](const int b) {
+            for (int i = b * BLOCK; i < std::min(n, (b + 1) * BLOCK); i++) {
+                int w{};
+                nbr(i, [&](const int j) {w += higher(j, i);});
+                wait[i].store(w, std::memory_order_relaxed);
             }
+        });
+        for (int i{}; i < n; i++) {
+            if (wait[i].load(std::memory_order_relaxed) == 0) frontier.emplace_back(i);
+        }
+        while (!frontier.empty()) {
+            const int m = frontier.size();
+            std::atomic<int> tail{0};
+            parallel::for_each(threads, blocks(m), [&](const int b) {
+                for (int k = b * BLOCK; k < std::min(m, (b + 1) * BLOCK); k++) {
+                    const int i = frontier[k];
+                    ColorSet<> used;
+                    nbr(i, [&](const int j) {
+                        if (higher(j, i)) used.set(color[j]);
+                    });
+                    color[i] = used.first_free();
+                    nbr(i, [&](const int j) {
+                        if (higher(i, j) && wait[j].fetch_sub(1, std::memory_order_acq_rel) == 1) next[tail++] = j;
+                    });
+                }
+            });
+            frontier.assign(next.begin(), next.begin() + tail.load());
         }
         return color;
     }
 
-    std::vector<int> color_face(const std::vector<Node>& P, const std::vector<Triangle>& T) {
-        const int N = P.size();
-        const int K = T.size();
-        if (N < 3) return std::vector<int>(K, 0);
-        std::vector<std::vector<int>> G(N);
-        std::vector<int> nb(N, 0);
-        for (int i{}; i < K; i++) {
-            const auto& t = T[i];
-            for (int j{}; j < 3; j++) {
-                G[t.p[j]].emplace_back(i);
-                nb[t.p[j]]++;
+    template <class F>
+    std::vector<int> smallest_last(const int n, const int limit, F&& nbr) {
+        std::vector<int> d(n, 0), pos(n), vert(n), color(n, -1);
+        if (n == 0) return color;
+        for (int v{}; v < n; v++) nbr(v, [&](const int) {d[v]++;});
+        const int md = *std::max_element(d.begin(), d.end());
+        std::vector<int> bin(md + 1, 0);
+        for (auto x : d) bin[x]++;
+        for (int k{}, start{}; k <= md; k++) {
+            const int num = bin[k];
+            bin[k] = start;
+            start += num;
+        }
+        for (int v{}; v < n; v++) {
+            pos[v] = bin[d[v]]++;
+            vert[pos[v]] = v;
+        }
+        for (int k = md; k > 0; k--) bin[k] = bin[k - 1];
+        bin[0] = 0;
+        for (int i{}; i < n; i++) {
+            const int v = vert[i];
+            nbr(v, [&](const int u) {
+                if (d[u] <= d[v]) return;
+                const int du = d[u], pu = pos[u], pw = bin[du], w = vert[pw];
+                if (u != w) {
+                    pos[u] = pw; vert[pu] = w;
+                    pos[w] = pu; vert[pw] = u;
+                }
+                bin[du]++;
+                d[u]--;
+            });
+        }
+        Kempe kempe;
+        for (int i = n - 1; i >= 0; i--) {
+            const int v = vert[i];
+            ColorSet<> used;
+            nbr(v, [&](const int u) {
+                if (color[u] != -1) used.set(color[u]);
+            });
+            color[v] = used.first_free();
+            if (color[v] >= limit && limit > 1) {
+                const int c = kempe(color, v, limit, nbr);
+                if (c != -1) color[v] = c;
             }
         }
-        const auto tdeg = [&](int i) {
-            return nb[T[i].p[0]] + nb[T[i].p[1]] + nb[T[i].p[2]] - 5;
-        };
-        std::vector<int> color(K, -1), sat(K, 0);
-        std::vector<boost::dynamic_bitset<>> usd(K);
-        std::priority_queue<std::tuple<int,int,int>> que;
-        for (int i{}; i < K; i++) que.emplace(sat[i], tdeg(i), i);
-        for (int i{}; i < K; i++) {
-            int j = -1;
-            while (!que.empty()) {
-                auto [clrd, sz, cand] = que.top(); que.pop();
-                if (color[cand] != -1 || clrd != sat[cand]) continue;
-                j = cand;
-                break;
-            }
-            color[j] = 0;
-            while (color[j] < (int)usd[j].size() && usd[j].test(color[j])) color[j]++;
-            usd[j].resize(color[j] + 1);
-            for (int x{}; x < 3; x++) {
-                for (auto k : G[T[j].p[x]]) {
-                    if (k == j || color[k] != -1) continue;
-                    if ((int)usd[k].size() <= color[j]) {
-                        usd[k].resize(color[j] + 1);
-                    }
-                    if (usd[k].test(color[j])) continue;
-                    usd[k].set(color[j]);
-                    sat[k]++;
-                    que.emplace(sat[k], tdeg(k), k);
+        return color;
+    }
+
+    template <class F>
+    void iterated_greedy(std::vector<int>& color, const uint32_t threads, F&& nbr) {
+        constexpr int BLOCK = 1 << 10;
+        const int n = color.size();
+        if (n == 0) return;
+        const int k = *std::max_element(color.begin(), color.end()) + 1;
+        std::vector<int> start(k + 1, 0), order(n), recolored(n, -1);
+        for (auto c : color) start[c + 1]++;
+        for (int c{}; c < k; c++) start[c + 1] += start[c];
+        std::vector<int> pos(start.begin(), start.end() - 1);
+        for (int i{}; i < n; i++) order[pos[color[i]]++] = i;
+        for (int c = k - 1; c >= 0; c--) {
+            const int lo = start[c], m = start[c + 1] - lo;
+            parallel::for_each(threads, (m + BLOCK - 1) / BLOCK, [&](const int b) {
+                for (int t = lo + b * BLOCK; t < lo + std::min(m, (b + 1) * BLOCK); t++) {
+                    const int i = order[t];
+                    ColorSet<> used;
+                    nbr(i, [&](const int j) {
+                        if (recolored[j] != -1) used.set(recolored[j]);
+                    });
+                    recolored[i] = used.first_free();
                 }
+            });
+        }
+        color.swap(recolored);
+    }
+
+    template <class F>
+    void repair(std::vector<int>& color, std::vector<int> touched, F&& nbr) {
+        int limit{};
+        for (auto c : color) limit = std::max(limit, c + 1);
+        for (auto v : touched) {
+            if (color[v] == -1) continue;
+            nbr(v, [&](const int u) {
+                if (color[u] == color[v]) color[v] = -1;
+            });
+        }
+        touched.erase(std::remove_if(touched.begin(), touched.end(), [&](const int v) {return color[v] != -1;}), touched.end());
+        std::sort(touched.begin(), touched.end());
+        touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+        Kempe kempe;
+        while (!touched.empty()) {
+            int best{}, bsat = -1;
+            for (int k{}; k < (int)touched.size(); k++) {
+                ColorSet<> used;
+                int sat{};
+                nbr(touched[k], [&](const int u) {
+                    if (color[u] != -1 && !used.test(color[u])) {used.set(color[u]); sat++;}
+                });
+                if (sat > bsat) {best = k; bsat = sat;}
+            }
+            const int v = touched[best];
+            touched.erase(touched.begin() + best);
+            ColorSet<> used;
+            nbr(v, [&](const int u) {
+                if (color[u] != -1) used.set(color[u]);
+            });
+            color[v] = used.first_free();
+            if (color[v] >= limit) {
+                const int c = kempe(color, v, limit, nbr);
+                if (c != -1) color[v] = c;
+                else limit = color[v] + 1;
             }
         }
+        std::vector<int> rank(limit, -1);
+        for (auto c : color) {
+            if (c != -1) rank[c] = 0;
+        }
+        int k{};
+        for (auto& r : rank) {
+            if (r != -1) r = k++;
+        }
+        if (k == limit) return;
+        for (auto& c : color) {
+            if (c != -1) c = rank[c];
+        }
+    }
+
+    template <class F>
+    std::vector<int> color_graph(const std::vector<int>& deg, const Options& opt, F&& nbr) {
+        auto color = [&] {
+            switch (opt.engine) {
+                case Engine::JonesPlassmann: return jones_plassmann(deg, opt.threads, nbr);
+                case Engine::SmallestLast: return smallest_last(deg.size(), opt.kempe_limit, nbr);
+                default: return dsatur_color(deg, nbr);
+            }
+        }();
+        for (uint32_t r{}; r < opt.refine; r++) iterated_greedy(color, opt.threads, nbr);
         return color;
     }
 
+    std::vector<int> color_point(const Graph& G, const Options& opt = {}) {
+        const int N = G.N;
+        if (N < 3) return std::vector<int>(N, 0);
+        std::vector<int> deg(N);
+        for (int i{}; i < N; i++) deg[i] = G.degree(i);
+        return color_graph(deg, opt, [&](const int u, auto&& f) {G.for_each_neighbor(u, f);});
+    }
+
+    std::vector<int> color_planar(const Graph& G, const bool five = false) {
+        Options opt;
+        opt.engine = Engine::SmallestLast;
+        opt.kempe_limit = five ? 5 : 0;
+        return color_point(G, opt);
+    }
+
+    std::vector<int> color_edge(const Graph& G, const Options& opt = {}) {
+        const int N = G.N;
+        const int M = G.M;
+        if (N < 3) return std::vector<int>(M, 0);
+        std::vector<int> deg(M);
+        for (int i{}; i < M; i++) deg[i] = G.degree(G.E[i].first) + G.degree(G.E[i].second) - 2;
+        return color_graph(deg, opt, [&](const int j, auto&& f) {G.for_each_adjacent_edge(j, f);});
+    }
+
+    std::vector<int> color_face(const Graph& G, const Options& opt = {}) {
+        const int N = G.N;
+        const int K = G.K;
+        if (N < 3) return std::vector<int>(K, 0);
+        std::vector<int> deg(K);
+        for (int i{}; i < K; i++) deg[i] = G.faces(G.T[i].p[0]) + G.faces(G.T[i].p[1]) + G.faces(G.T[i].p[2]) - 5;
+        return color_graph(deg, opt, [&](const int j, auto&& f) {G.for_each_adjacent_face(j, f);});
+    }
+
+    void repair_point(const Graph& G, std::vector<int>& color, const std::vector<int>& touched) {
+        color.resize(G.N, -1);
+        repair(color, touched, [&](const int u, auto&& f) {G.for_each_neighbor(u, f);});
+    }
+
+    void repair_edge(const Graph& G, std::vector<int>& color, const std::vector<int>& touched) {
+        color.resize(G.M, -1);
+        repair(color, touched, [&](const int j, auto&& f) {G.for_each_adjacent_edge(j, f);});
+    }
+
+    void repair_face(const Graph& G, std::vector<int>& color, const std::vector<int>& touched) {
+        color.resize(G.K, -1);
+        repair(color, touched, [&](const int j, auto&& f) {G.for_each_adjacent_face(j, f);});
+    }
+
     std::vector<std::tuple<int,int,int>> rgb_color(std::vector<int> color) {
         std::sort(color.begin(), color.end());
         color.erase(unique(color.begin(), color.end()), color.end());
@@ -162,7 +473,7 @@ namespace dsatur {
                 double c = v * s;
                 double x = c * (1 - std::abs(std::fmod(h/60, 2) - 1));
                 double m = v - c;
-                auto [r, g, b] = [&] -> std::tuple<double, double, double> {
+                auto [r, g, b] = [&]() -> std::tuple<double, double, double> {
                     if (h < 60) return std::make_tuple(c, x, 0);
                     if (h < 120) return std::make_tuple(x, c, 0);
                     if (h < 180) return std::make_tuple(0, c, x);
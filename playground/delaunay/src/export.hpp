@@ -0,0 +1,145 @@
+#pragma once
+#include "components.hpp"
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <charconv>
+#include <functional>
+#include <span>
+
+namespace io {
+    enum class Kind : uint32_t {
+        Points = 1,
+        Edges = 2,
+        Triangles = 3
+    };
+
+    struct Header {
+        char magic[8] = {'D', 'E', 'L', 'A', 'U', 'N', 'A', 'Y'};
+        uint32_t format = 1;
+        Kind kind{};
+        uint64_t count{};
+    };
+
+    class Writer {
+    public:
+        using Sink = std::function<void(const char*, size_t)>;
+        explicit Writer(Sink s, const size_t capacity = 1 << 16) : sink(std::move(s)), buf(std::max<size_t>(capacity, 64)) {}
+        explicit Writer(std::FILE* f, const size_t capacity = 1 << 16)
+            : Writer([f](const char* p, size_t n) {std::fwrite(p, 1, n, f);}, capacity) {}
+        explicit Writer(std::string& s, const size_t capacity = 1 << 16)
+            : Writer([&s](const char* p, size_t n) {s.append(p, n);}, capacity) {}
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+        ~Writer() {flush();}
+
+        void put(const char c) {
+            if (len == buf.size()) flush();
+            buf[len++] = c;
+        }
+        template <class T>
+        void number(const T v) {
+            if (buf.size() - len < 32) flush();
+            len = std::to_chars(buf.data() + len, buf.data() + buf.size(), v).ptr - buf.data();
+        }
+        void bytes(const void* p, size_t n) {
+            const char* c = static_cast<const char*>(p);
+            while (n > 0) {
+                if (len == buf.size()) flush();
+                const size_t k = std::min(n, buf.size() - len);
+                std::memcpy(buf.data() + len, c, k);
+                len += k;
+                c += k;
+                n -= k;
+            }
+        }
+        void flush() {
+            if (len > 0) sink(buf.data(), len);
+            len = 0;
+        }
+    private:
+        Sink sink;
+        std::vector<char> buf;
+        size_t len{};
+    };
+
+    template <class S>
+    void write_points_text(Writer& w, const std::vector<Point<S>>& P) {
+        w.number(P.size());
+        w.put('\n');
+        for (const auto& p : P) {
+            w.number(p.x);
+            w.put(' ');
+            w.number(p.y);
+            w.put('\n');
+        }
+    }
+
+    inline void write_edges_text(Writer& w, const size_t N, const std::vector<std::pair<int,int>>& E) {
+        w.number(N);
+        w.put(' ');
+        w.number(E.size());
+        w.put('\n');
+        for (const auto& [u, v] : E) {
+            w.number(u);
+            w.put(' ');
+            w.number(v);
+            w.put('\n');
+        }
+    }
+
+    inline void write_triangles_text(Writer& w, const std::vector<Triangle>& T) {
+        w.number(T.size());
+        w.put('\n');
+        for (const auto& t : T) {
+            w.number(t.p[0]);
+            w.put(' ');
+            w.number(t.p[1]);
+            w.put(' ');
+            w.number(t.p[2]);
+            w.put('\n');
+        }
+    }
+
+    inline void write_header(Writer& w, const Kind kind, const uint64_t count) {
+        Header h;
+        h.kind = kind;
+        h.count = count;
+        w.bytes(&h, sizeof(h));
+    }
+
+    template <class S>
+    void write_points_binary(Writer& w, const std::vector<Point<S>>& P) {
+        write_header(w, Kind::Points, P.size());
+        for (const auto& p : P) {
+            const double xy[2] = {(double)p.x, (double)p.y};
+            w.bytes(xy, sizeof(xy));
+        }
+    }
+
+    inline void write_edges_binary(Writer& w, const std::vector<std::pair<int,int>>& E) {
+        write_header(w, Kind::Edges, E.size());
+        for (const auto& [u, v] : E) {
+            const uint32_t uv[2] = {(uint32_t)u, (uint32_t)v};
+            w.bytes(uv, sizeof(uv));
+        }
+    }
+
+    inline void write_triangles_binary(Writer& w, const std::vector<Triangle>& T) {
+        write_header(w, Kind::Triangles, T.size());
+        for (const auto& t : T) w.bytes(t.p, sizeof(t.p));
+    }
+
+    template <class T>
+    std::span<const T> view(const void* data, const size_t size, const Kind kind) {
+        const size_t width = kind == Kind::Triangles ? 3 : 2;
+        if (size < sizeof(Header)) return {};
+        Header h;
+        std::memcpy(&h, data, sizeof(h));
+        if (std::memcmp(h.magic, Header{}.magic, sizeof(h.magic)) != 0 || h.format != 1 || h.kind != kind) return {};
+        if ((size - sizeof(Header)) / sizeof(T) < h.count * width) return {};
+        return {reinterpret_cast<const T*>(static_cast<const char*>(data) + sizeof(Header)), h.count * width};
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include "export.hpp"
+#include <vector>
+#include <algorithm>
+#include <string_view>
+#include <charconv>
+#include <cstdint>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace io {
+    class MappedFile {
+    public:
+        explicit MappedFile(const char* path) {
+            const int fd = ::open(path, O_RDONLY);
+            if (fd < 0) return;
+            struct stat st{};
+            if (::fstat(fd, &st) == 0) {
+                len = st.st_size;
+                ok = true;
+                if (len > 0) {
+                    ptr = ::mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+                    if (ptr == MAP_FAILED) {
+                        ptr = nullptr;
+                        len = 0;
+                        ok = false;
+                    }
+                }
+            }
+            ::close(fd);
+        }
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        ~MappedFile() {
+            if (ptr != nullptr) ::munmap(ptr, len);
+        }
+        explicit operator bool() const {return ok;}
+        const char* data() const {return static_cast<const char*>(ptr);}
+        size_t size() const {return len;}
+        std::string_view text() const {return {data(), len};}
+    private:
+        void* ptr = nullptr;
+        size_t len{};
+        bool ok = false;
+    };
+
+    inline std::vector<double> parse_points(std::string_view s) {
+        std::vector<double> xy;
+        xy.reserve(2*(std::count(s.begin(), s.end(), '\n') + 1));
+        const auto blank = [](const char c) {return c == ' ' || c == '\t' || c == ',' || c == ';' || c == '\r';};
+        while (!s.empty()) {
+            const size_t nl = s.find('\n');
+            std::string_view line = s.substr(0, nl);
+            s.remove_prefix(nl == std::string_view::npos ? s.size() : nl + 1);
+            double v[2];
+            int k{};
+            const char* p = line.data();
+            const char* end = line.data() + line.size();
+            while (k < 2) {
+                while (p != end && blank(*p)) p++;
+                if (p == end) break;
+                const auto [q, ec] = std::from_chars(p, end, v[k]);
+                if (ec != std::errc{}) {k = -1; break;}
+                p = q;
+                k++;
+            }
+            if (k == 2) {
+                xy.emplace_back(v[0]);
+                xy.emplace_back(v[1]);
+            }
+        }
+        return xy;
+    }
+}
\ No newline at end of file
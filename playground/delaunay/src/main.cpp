@@ -1,11 +1,14 @@
 #include "delaunay.hpp"
 #include "dsatur.hpp"
+#include "export.hpp"
 #include <emscripten.h>
 #include <emscripten/html5.h>
-#include <ranges>
+#include <string>
+#include <tuple>
 #include <vector>
 #include <cmath>
 #include <algorithm>
+#include <charconv>
 
 EM_JS(int, js_canvas_css_w, (), {
     const c = document.getElementById('canvas');
@@ -76,42 +79,57 @@ EM_JS(void, js_setup_copy, (), {
     }
 });
 
-EM_JS(void, js_set_stroke, (const char* color, float width), {
+EM_JS(void, js_stroke_lines, (const double* xy, const int* start, int k, const char* styles, float width), {
     const ctx = document.getElementById('canvas').getContext('2d');
-    ctx.strokeStyle = UTF8ToString(color);
+    const style = UTF8ToString(styles).split('\n');
     ctx.lineWidth = width;
     ctx.lineJoin = 'round';
     ctx.lineCap = 'round';
+    for (let c = 0; c < k; c++) {
+        const lo = HEAP32[(start >> 2) + c], hi = HEAP32[(start >> 2) + c + 1];
+        if (lo == hi) continue;
+        ctx.strokeStyle = style[c];
+        ctx.beginPath();
+        for (let i = lo, o = (xy >> 3) + 4*lo; i < hi; i++, o += 4) {
+            ctx.moveTo(HEAPF64[o], HEAPF64[o+1]);
+            ctx.lineTo(HEAPF64[o+2], HEAPF64[o+3]);
+        }
+        ctx.stroke();
+    }
 });
 
-EM_JS(void, js_draw_line, (double x1, double y1, double x2, double y2), {
-    const ctx = document.getElementById('canvas').getContext('2d');
-    ctx.beginPath();
-    ctx.moveTo(x1, y1);
-    ctx.lineTo(x2, y2);
-    ctx.stroke();
-});
-
-EM_JS(void, js_set_fill, (const char* color), {
-    const ctx = document.getElementById('canvas').getContext('2d');
-    ctx.fillStyle = UTF8ToString(color);
-});
-
-EM_JS(void, js_draw_point, (double x, double y, double r), {
+EM_JS(void, js_fill_points, (const double* xy, const int* start, int k, const char* styles, double r), {
     const ctx = document.getElementById('canvas').getContext('2d');
-    ctx.beginPath();
-    ctx.arc(x, y, r, 0, 2*Math.PI);
-    ctx.fill();
+    const style = UTF8ToString(styles).split('\n');
+    for (let c = 0; c < k; c++) {
+        const lo = HEAP32[(start >> 2) + c], hi = HEAP32[(start >> 2) + c + 1];
+        if (lo == hi) continue;
+        ctx.fillStyle = style[c];
+        ctx.beginPath();
+        for (let i = lo, o = (xy >> 3) + 2*lo; i < hi; i++, o += 2) {
+            ctx.moveTo(HEAPF64[o] + r, HEAPF64[o+1]);
+            ctx.arc(HEAPF64[o], HEAPF64[o+1], r, 0, 2*Math.PI);
+        }
+        ctx.fill();
+    }
 });
 
-EM_JS(void, js_fill_triangle, (double x1, double y1, double x2, double y2, double x3, double y3), {
+EM_JS(void, js_fill_triangles, (const double* xy, const int* start, int k, const char* styles), {
     const ctx = document.getElementById('canvas').getContext('2d');
-    ctx.beginPath();
-    ctx.moveTo(x1, y1);
-    ctx.lineTo(x2, y2);
-    ctx.lineTo(x3, y3);
-    ctx.closePath();
-    ctx.fill();
+    const style = UTF8ToString(styles).split('\n');
+    for (let c = 0; c < k; c++) {
+        const lo = HEAP32[(start >> 2) + c], hi = HEAP32[(start >> 2) + c + 1];
+        if (lo == hi) continue;
+        ctx.fillStyle = style[c];
+        ctx.beginPath();
+        for (let i = lo, o = (xy >> 3) + 6*lo; i < hi; i++, o += 6) {
+            ctx.moveTo(HEAPF64[o], HEAPF64[o+1]);
+            ctx.lineTo(HEAPF64[o+2], HEAPF64[o+3]);
+            ctx.lineTo(HEAPF64[o+4], HEAPF64[o+5]);
+            ctx.closePath();
+        }
+        ctx.fill();
+    }
 });
 
 enum class ColorMode {
@@ -120,10 +138,6 @@ enum class ColorMode {
     f = 2
 };
 static int color_mode = -1;
-extern "C" {
-    EMSCRIPTEN_KEEPALIVE void set_color_mode(int m) {color_mode = m;}
-    EMSCRIPTEN_KEEPALIVE void sync_canvas() {js_sync_canvas_resolution();}
-}
 
 static int maxdeg;
 static int maxclr;
@@ -132,8 +146,114 @@ static std::string color_box;
 class Renderer {
 public:
     void draw() {
+        const double w = js_canvas_css_w(), h = js_canvas_css_h();
+        const bool stale = mesh.getVersion() != version || color_mode != mode;
+        if (!stale && !dirty && w == W && h == H) return;
+        frame = {};
+        {
+            stats::Timer timer(frame.seconds[stats::Edges]);
+            mesh.getEdges();
+        }
+        if (stale) {
+            stats::Timer timer(frame.seconds[stats::Color]);
+            recolor();
+        }
+        dirty = false;
+        W = w;
+        H = h;
+        {
+            stats::Timer timer(frame.seconds[stats::Draw]);
+            paint();
+        }
+        update_stats();
+    }
+    void onClick(int px, int py) {
+        auto [x, y] = world_xy(px, py);
+        pending_points.emplace_back(mesh.insertPoint(x, y));
+        for (auto t : mesh.getChangedTriangles()) pending_tris.emplace_back(t);
+        update_info();
+    }
+    void invalidate() {dirty = true;}
+private:
+    delaunay::DelaunayTriangulation mesh;
+    uint64_t version = UINT64_MAX;
+    int mode = -2;
+    dsatur::Graph graph;
+    uint64_t graph_version = UINT64_MAX;
+    std::vector<int> color, he_color;
+    std::vector<int> pending_points, pending_tris;
+    std::vector<std::string> palette;
+    std::string styles;
+    std::vector<double> buf;
+    std::vector<int> start, pos;
+    std::string dump, panel;
+    uint64_t dump_version = UINT64_MAX;
+    stats::Counters frame;
+    double W{}, H{};
+    bool dirty = true;
+    const float LINE_WIDTH = 2.0f;
+    const float POINT_RADIUS = 6.0f;
+    void paint() {
         js_clear();
+
+        const auto& points = mesh.getPoints();
+        const auto& edges = mesh.getEdges();
+        const auto& triangles = mesh.getTriangles();
+        const auto& canonical = mesh.getCanonical();
+        const int K = palette.size();
+        const std::string white = "rgb(255,255,255)";
+
+        if ((ColorMode)mode == ColorMode::f) {
+            layer(triangles.size(), K, 6, [&](uint32_t i) {return color[i];}, [&](uint32_t i, double* xy) {
+                for (auto v : triangles[i].p) {
+                    std::tie(xy[0], xy[1]) = canvas_xy(points[v].x, points[v].y);
+                    xy += 2;
+                }
+            });
+            js_fill_triangles(buf.data(), start.data(), K, styles.c_str());
+        }
+        const bool ce = (ColorMode)mode == ColorMode::e;
+        layer(edges.size(), ce ? K : 1, 4, [&](uint32_t i) {return ce ? color[i] : 0;}, [&](uint32_t i, double* xy) {
+            const auto& [u, v] = edges[i];
+            std::tie(xy[0], xy[1]) = canvas_xy(points[u].x, points[u].y);
+            std::tie(xy[2], xy[3]) = canvas_xy(points[v].x, points[v].y);
+        });
+        js_stroke_lines(buf.data(), start.data(), ce ? K : 1, (ce ? styles : white).c_str(), LINE_WIDTH);
+        const bool cp = (ColorMode)mode == ColorMode::p;
+        layer(points.size(), cp ? K : 1, 2, [&](uint32_t i) {return canonical[i] != i ? -1 : cp ? color[i] : 0;}, [&](uint32_t i, double* xy) {
+            std::tie(xy[0], xy[1]) = canvas_xy(points[i].x, points[i].y);
+        });
+        js_fill_points(buf.data(), start.data(), cp ? K : 1, (cp ? styles : white).c_str(), POINT_RADIUS);
+    }
+    std::pair<double, double> canvas_xy(double x, double y) {
+        return std::make_pair(x * W, (1.0 - y) * H);
+    }
+    template <class C, class F>
+    void layer(const uint32_t n, const int k, const int stride, C&& col, F&& put) {
+        start.assign(k + 1, 0);
+        for (uint32_t i{}; i < n; i++) {
+            if (col(i) >= 0) start[col(i) + 1]++;
+        }
+        for (int c{}; c < k; c++) start[c + 1] += start[c];
+        buf.resize((size_t)stride * start[k]);
+        pos.assign(start.begin(), start.end() - 1);
+        for (uint32_t i{}; i < n; i++) {
+            const int c = col(i);
+            if (c >= 0) put(i, &buf[(size_t)stride * pos[c]++]);
+        }
+    }
+    std::pair<double, double> world_xy(double x, double y) {
+        const double cw = js_canvas_css_w();
+        const double ch = js_canvas_css_h();
+        return std::make_pair(x / cw, 1.0 - y / ch);
+    }
+    void recolor() {
+        const bool incremental = color_mode == mode && mode != -1;
+        version = mesh.getVersion();
+        mode = color_mode;
         color_box.clear();
+        palette.clear();
+        styles.clear();
 
         const auto& points = mesh.getPoints();
         const auto& edges = mesh.getEdges();
@@ -145,7 +265,7 @@ public:
                 deg[u]++;
                 deg[v]++;
             }
-            return *std::max_element(deg.begin(), deg.end());
+            return deg.empty() ? 0 : *std::max_element(deg.begin(), deg.end());
         }();
 
         const auto rgb_string = [](int r, int g, int b) {
@@ -161,133 +281,128 @@ public:
             auto A = std::to_string(a);
             return "rgba("+R+", "+G+", "+B+", "+A+")";
         };
-        auto add_color_box = [&](const std::string& s) {
-            color_box += "<span class='color-box' style='background-color:" + s + "'></span>";
-        };
-        const auto draw_edge = [&](const int colored) {
-            if (colored) {
-                const auto e_color = dsatur::color_edge(points, edges);
-                const auto rgb = dsatur::rgb_color(e_color);
-                maxclr = rgb.size();
-                for (const auto& [r, g, b] : rgb) {
-                    add_color_box(rgb_string(r, g, b));
-                }
-                for (const auto& [e, c] : std::views::zip(edges, e_color)) {
-                    const auto& [u, v] = e;
-                    const auto& [r, g, b] = rgb[c];
-                    auto [ux, uy] = canvas_xy(points[u].x, points[u].y);
-                    auto [vx, vy] = canvas_xy(points[v].x, points[v].y);
-                    js_set_stroke(rgb_string(r, g, b).c_str(), LINE_WIDTH);
-                    js_draw_line(ux, uy, vx, vy);
-                }
-            }
-            else {
-                js_set_stroke("rgb(255,255,255)", LINE_WIDTH);
-                for (const auto& [u, v] : edges) {
-                    auto [ux, uy] = canvas_xy(points[u].x, points[u].y);
-                    auto [vx, vy] = canvas_xy(points[v].x, points[v].y);
-                    js_draw_line(ux, uy, vx, vy);
-                }
-            }
-        };
-        const auto draw_point = [&](const int colored) {
-            if (colored) {
-                const auto p_color = dsatur::color_point(points, edges);
-                const auto rgb = dsatur::rgb_color(p_color);
-                for (const auto& [r, g, b] : rgb) {
-                    add_color_box(rgb_string(r, g, b));
-                }
-                maxclr = rgb.size();
-                for (const auto& [p, c] : std::views::zip(points, p_color)) {
-                    const auto& [r, g, b] = rgb[c];
-                    const auto& [x, y] = canvas_xy(p.x, p.y);
-                    js_set_fill(rgb_string(r, g, b).c_str());
-                    js_draw_point(x, y, POINT_RADIUS);
+        if (mode != -1 && graph_version != version) {
+            graph = dsatur::Graph(points.size(), edges, triangles);
+            graph_version = version;
+        }
+        switch ((ColorMode)mode) {
+            case ColorMode::p:
+                if (incremental) {
+                    std::vector<int> touched = pending_points;
+                    for (auto t : pending_tris) {
+                        for (auto v : triangles[t].p) touched.emplace_back(v);
+                    }
+                    dsatur::repair_point(graph, color, touched);
                 }
-            }
-            else {
-                js_set_fill("rgb(255,255,255)");
-                for (const auto& p : points) {
-                    auto [x, y] = canvas_xy(p.x, p.y);
-                    js_draw_point(x, y, POINT_RADIUS);
+                else color = dsatur::color_point(graph);
+                break;
+            case ColorMode::e:
+                if (incremental) repair_edges();
+                else color = dsatur::color_edge(graph);
+                he_color.assign(mesh.getHalfedges().size(), -1);
+                for (int i{}; i < (int)edges.size(); i++) {
+                    const uint32_t e = mesh.getEdgeHalfedges()[i], h = mesh.getHalfedges()[e];
+                    he_color[e] = color[i];
+                    if (h != delaunay::DelaunayTriangulation::NONE) he_color[h] = color[i];
                 }
-            }
-        };
-        if ((ColorMode)color_mode == ColorMode::f) {
-            const auto t_color = dsatur::color_face(points, triangles);
-            const auto rgb = dsatur::rgb_color(t_color);
-            maxclr = rgb.size();
-            for (const auto& [r, g, b] : rgb) {
-                add_color_box(rgba_string(r, g, b, 0.3));
-            }
-            for (const auto& [tri, c] : std::views::zip(triangles, t_color)) {
-                const auto& [r, g, b] = rgb[c];
-                auto [x1, y1] = canvas_xy(points[tri.p[0]].x, points[tri.p[0]].y);
-                auto [x2, y2] = canvas_xy(points[tri.p[1]].x, points[tri.p[1]].y);
-                auto [x3, y3] = canvas_xy(points[tri.p[2]].x, points[tri.p[2]].y);
-                js_set_fill(rgba_string(r, g, b, 0.3).c_str());
-                js_fill_triangle(x1, y1, x2, y2, x3, y3);
+                break;
+            case ColorMode::f:
+                if (incremental) dsatur::repair_face(graph, color, pending_tris);
+                else color = dsatur::color_face(graph);
+                break;
+            default: color.clear(); break;
+        }
+        pending_points.clear();
+        pending_tris.clear();
+        if (!color.empty()) {
+            for (const auto& [r, g, b] : dsatur::rgb_color(color)) {
+                palette.emplace_back((ColorMode)mode == ColorMode::f ? rgba_string(r, g, b, 0.3) : rgb_string(r, g, b));
+                color_box += "<span class='color-box' style='background-color:" + palette.back() + "'></span>";
+                styles += palette.back() + '\n';
             }
         }
-        draw_edge(((ColorMode)color_mode == ColorMode::e ? 1 : 0));
-        draw_point(((ColorMode)color_mode == ColorMode::p ? 1 : 0));
-        if (color_mode == -1) maxclr = 0;
-
-        update_stats();
-    }
-    void onClick(int px, int py) {
-        auto [x, y] = world_xy(px, py);
-        mesh.addPoint(x, y);
-        mesh.build();
-        update_info();
-    }
-private:
-    delaunay::DelaunayTriangulation mesh;
-    const float LINE_WIDTH = 2.0f;
-    const float POINT_RADIUS = 6.0f;
-    std::pair<double, double> canvas_xy(double x, double y) {
-        const double W = js_canvas_css_w();
-        const double H = js_canvas_css_h();
-        return std::make_pair(x * W, (1.0 - y) * H);
+        maxclr = palette.size();
     }
-    std::pair<double, double> world_xy(double x, double y) {
-        const double W = js_canvas_css_w();
-        const double H = js_canvas_css_h();
-        return std::make_pair(x / W, 1.0 - y / H);
+    void repair_edges() {
+        const auto& edges = mesh.getEdges();
+        const auto& eh = mesh.getEdgeHalfedges();
+        const auto& twin = mesh.getHalfedges();
+        std::vector<char> fresh(mesh.getTriangles().size(), 0);
+        for (auto t : pending_tris) fresh[t] = 1;
+        he_color.resize(twin.size(), -1);
+        color.assign(edges.size(), -1);
+        std::vector<int> touched;
+        for (int i{}; i < (int)edges.size(); i++) {
+            const uint32_t e = eh[i], h = twin[e];
+            if (!fresh[e / 3]) color[i] = he_color[e];
+            else if (h != delaunay::DelaunayTriangulation::NONE && !fresh[h / 3]) color[i] = he_color[h];
+            if (color[i] == -1) touched.emplace_back(i);
+        }
+        dsatur::repair_edge(graph, color, touched);
     }
     void update_info() {
-        const auto& points = mesh.getPoints();
-        const int N = points.size();
-        const auto& edges  = mesh.getEdges();
-        const int M = edges.size();
-        std::string s;
-        s += std::to_string(N);
-        s += ' ';
-        s += std::to_string(M);
-        s += '\n';
-        for (const auto& [u, v] : edges) {
-            s += std::to_string(u);
-            s += ' ';
-            s += std::to_string(v);
-            s += '\n';
+        if (dump_version == mesh.getVersion()) return;
+        dump_version = mesh.getVersion();
+        dump.clear();
+        {
+            io::Writer w(dump);
+            io::write_edges_text(w, mesh.getPoints().size(), mesh.getEdges());
         }
-        js_set_dump(s.c_str());
+        js_set_dump(dump.c_str());
     }
     void update_stats() {
         std::string info = "最大次数: " + std::to_string(maxdeg) + "<br>使用色数: " + std::to_string(maxclr) + " " + color_box;
-        js_set_stats(info.c_str());
+        if constexpr (stats::enabled) {
+            const auto& m = mesh.getStats();
+            for (int p{}; p < stats::PHASES; p++) {
+                const double sec = m.seconds[p] + frame.seconds[p];
+                if (sec == 0) continue;
+                char ms[32];
+                *std::to_chars(ms, ms + sizeof(ms) - 1, 1e3 * sec, std::chars_format::fixed, 2).ptr = '\0';
+                info += "<br>" + std::string(stats::phase_name[p]) + ": " + ms + " ms";
+            }
+            info += "<br>orient: " + std::to_string(m.orient) + ", in_circle: " + std::to_string(m.in_circle);
+            info += "<br>flips: " + std::to_string(m.flips) + ", allocations: " + std::to_string(m.allocations);
+        }
+        if (info == panel) return;
+        panel = std::move(info);
+        js_set_stats(panel.c_str());
     }
 };
 
 static Renderer G;
+static bool frame_pending = false;
+
+static EM_BOOL on_frame(double, void*) {
+    frame_pending = false;
+    G.draw();
+    return EM_FALSE;
+}
+
+static void request_redraw() {
+    if (frame_pending) return;
+    frame_pending = true;
+    emscripten_request_animation_frame(on_frame, nullptr);
+}
+
+extern "C" {
+    EMSCRIPTEN_KEEPALIVE void set_color_mode(int m) {
+        color_mode = m;
+        request_redraw();
+    }
+    EMSCRIPTEN_KEEPALIVE void sync_canvas() {
+        js_sync_canvas_resolution();
+        G.invalidate();
+        request_redraw();
+    }
+}
 
 static EM_BOOL on_mouse(int, const EmscriptenMouseEvent* e, void*) {
     G.onClick(e->targetX, e->targetY);
+    request_redraw();
     return EM_TRUE;
 }
 
-static void main_loop() {G.draw();}
-
 int main() {
     js_sync_canvas_resolution();
     js_setup_controls();
@@ -298,5 +413,5 @@ int main() {
         });
     });
     emscripten_set_mousedown_callback("#canvas", nullptr, 0, on_mouse);
-    emscripten_set_main_loop(main_loop, 0, 1);
+    request_redraw();
 }
\ No newline at end of file
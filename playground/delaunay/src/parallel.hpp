@@ -0,0 +1,86 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <cstdint>
+
+namespace parallel {
+    class Pool {
+    public:
+        static Pool& instance() {
+            static Pool pool;
+            return pool;
+        }
+        static bool busy() {return inside;}
+        Pool(const Pool&) = delete;
+        Pool& operator=(const Pool&) = delete;
+        ~Pool() {
+            {
+                std::lock_guard lk(m);
+                stop = true;
+            }
+            wake.notify_all();
+            for (auto& th : workers) th.join();
+        }
+        template <class W>
+        void run(const uint32_t helpers, W& work) {
+            std::lock_guard job(submit);
+            {
+                std::lock_guard lk(m);
+                while (workers.size() < helpers) workers.emplace_back(&Pool::loop, this, (uint32_t)workers.size(), generation);
+                call = [](void* p) {(*static_cast<W*>(p))();};
+                ctx = &work;
+                wanted = active = helpers;
+                generation++;
+            }
+            wake.notify_all();
+            inside = true;
+            work();
+            inside = false;
+            std::unique_lock lk(m);
+            done.wait(lk, [&] {return active == 0;});
+        }
+    private:
+        Pool() = default;
+        void loop(const uint32_t id, uint64_t seen) {
+            inside = true;
+            std::unique_lock lk(m);
+            while (true) {
+                wake.wait(lk, [&] {return stop || generation != seen;});
+                if (stop) return;
+                seen = generation;
+                if (id >= wanted) continue;
+                lk.unlock();
+                call(ctx);
+                lk.lock();
+                if (--active == 0) done.notify_one();
+            }
+        }
+    private:
+        static inline thread_local bool inside = false;
+        std::mutex submit, m;
+        std::condition_variable wake, done;
+        std::vector<std::thread> workers;
+        void (*call)(void*) = nullptr;
+        void* ctx = nullptr;
+        uint64_t generation{};
+        uint32_t wanted{}, active{};
+        bool stop = false;
+    };
+
+    template <class F>
+    void for_each(const uint32_t threads, const uint32_t n, F&& f) {
+        if (threads <= 1 || n <= 1 || Pool::busy()) {
+            for (uint32_t i{}; i < n; i++) f(i);
+            return;
+        }
+        std::atomic<uint32_t> next{0};
+        auto work = [&] {
+            for (uint32_t i = next++; i < n; i = next++) f(i);
+        };
+        Pool::instance().run(std::min(threads, n) - 1, work);
+    }
+}
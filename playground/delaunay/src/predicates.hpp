@@ -0,0 +1,155 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+namespace predicates {
+    namespace detail {
+        constexpr double eps = std::numeric_limits<double>::epsilon() / 2;
+        constexpr double ccwerrboundA = (3.0 + 16.0 * eps) * eps;
+        constexpr double iccerrboundA = (10.0 + 96.0 * eps) * eps;
+
+        template <size_t N>
+        struct Expansion {
+            double v[N];
+            size_t n = 0;
+            void push(const double x) {v[n++] = x;}
+            double sign() const {return v[n-1];}
+        };
+
+        inline void fast_two_sum(const double a, const double b, double& x, double& y) {
+            x = a + b;
+            y = b - (x - a);
+        }
+        inline void two_sum(const double a, const double b, double& x, double& y) {
+            x = a + b;
+            const double bv = x - a, av = x - bv;
+            y = (a - av) + (b - bv);
+        }
+        inline Expansion<2> two_diff(const double a, const double b) {
+            Expansion<2> h;
+            const double x = a - b;
+            const double bv = a - x, av = x + bv;
+            const double y = (a - av) + (bv - b);
+            if (y != 0) h.push(y);
+            h.push(x);
+            return h;
+        }
+        template <size_t A, size_t B, size_t N = A + B>
+        inline Expansion<N> sum(const Expansion<A>& e, const Expansion<B>& f) {
+            Expansion<N> h;
+            size_t i{}, j{};
+            const auto take = [&]() {
+                if (j == f.n || (i < e.n && (f.v[j] > e.v[i]) == (f.v[j] > -e.v[i]))) return e.v[i++];
+                return f.v[j++];
+            };
+            double Q = take(), Qnew, hh;
+            if (i < e.n || j < f.n) {
+                fast_two_sum(take(), Q, Qnew, hh);
+                Q = Qnew;
+                if (hh != 0) h.push(hh);
+            }
+            while (i < e.n || j < f.n) {
+                two_sum(Q, take(), Qnew, hh);
+                Q = Qnew;
+                if (hh != 0) h.push(hh);
+            }
+            if (Q != 0 || h.n == 0) h.push(Q);
+            return h;
+        }
+        template <size_t A>
+        inline Expansion<2*A> scale(const Expansion<A>& e, const double b) {
+            Expansion<2*A> h;
+            double Q = e.v[0] * b, hh = std::fma(e.v[0], b, -Q), sm;
+            if (hh != 0) h.push(hh);
+            for (size_t i{1}; i < e.n; i++) {
+                const double p1 = e.v[i] * b, p0 = std::fma(e.v[i], b, -p1);
+                two_sum(Q, p0, sm, hh);
+                if (hh != 0) h.push(hh);
+                fast_two_sum(p1, sm, Q, hh);
+                if (hh != 0) h.push(hh);
+            }
+            if (Q != 0 || h.n == 0) h.push(Q);
+            return h;
+        }
+        template <size_t A, size_t B>
+        inline Expansion<2*A*B> mul(const Expansion<A>& e, const Expansion<B>& f) {
+            Expansion<2*A*B> h;
+            const auto s = scale(e, f.v[0]);
+            for (size_t i{}; i < s.n; i++) h.push(s.v[i]);
+            for (size_t i{1}; i < f.n; i++) h = sum<2*A*B, 2*A, 2*A*B>(h, scale(e, f.v[i]));
+            return h;
+        }
+        template <size_t A>
+        inline Expansion<A> neg(Expansion<A> e) {
+            for (size_t i{}; i < e.n; i++) e.v[i] = -e.v[i];
+            return e;
+        }
+
+        inline double orient2d_exact(double ax, double ay, double bx, double by, double cx, double cy) {
+            const auto acx = two_diff(ax, cx), acy = two_diff(ay, cy);
+            const auto bcx = two_diff(bx, cx), bcy = two_diff(by, cy);
+            return sum(mul(acx, bcy), neg(mul(acy, bcx))).sign();
+        }
+        template <size_t D>
+        inline double incircle_exact(const Expansion<D>& adx, const Expansion<D>& ady, const Expansion<D>& bdx,
+                                     const Expansion<D>& bdy, const Expansion<D>& cdx, const Expansion<D>& cdy) {
+            const auto alift = sum(mul(adx, adx), mul(ady, ady));
+            const auto blift = sum(mul(bdx, bdx), mul(bdy, bdy));
+            const auto clift = sum(mul(cdx, cdx), mul(cdy, cdy));
+            const auto bc = sum(mul(bdx, cdy), neg(mul(cdx, bdy)));
+            const auto ca = sum(mul(cdx, ady), neg(mul(adx, cdy)));
+            const auto ab = sum(mul(adx, bdy), neg(mul(bdx, ady)));
+            return sum(sum(mul(alift, bc), mul(blift, ca)), mul(clift, ab)).sign();
+        }
+        inline double incircle_exact(double ax, double ay, double bx, double by, double cx, double cy, double dx, double dy) {
+            const Expansion<2> d[6] = {two_diff(ax, dx), two_diff(ay, dy), two_diff(bx, dx), two_diff(by, dy), two_diff(cx, dx), two_diff(cy, dy)};
+            if (std::all_of(d, d + 6, [](const auto& e) {return e.n == 1;})) {
+                Expansion<1> h[6];
+                for (size_t i{}; i < 6; i++) h[i].push(d[i].v[0]);
+                return incircle_exact(h[0], h[1], h[2], h[3], h[4], h[5]);
+            }
+            return incircle_exact(d[0], d[1], d[2], d[3], d[4], d[5]);
+        }
+    }
+
+    // > 0 if a, b, c are counterclockwise, < 0 if clockwise, 0 if collinear (exact sign).
+    inline double orient2d(double ax, double ay, double bx, double by, double cx, double cy) {
+        const double detleft = (ax - cx) * (by - cy);
+        const double detright = (ay - cy) * (bx - cx);
+        const double det = detleft - detright;
+        double detsum;
+        if (detleft > 0) {
+            if (detright <= 0) return det;
+            detsum = detleft + detright;
+        }
+        else if (detleft < 0) {
+            if (detright >= 0) return det;
+            detsum = -detleft - detright;
+        }
+        else return det;
+        const double errbound = detail::ccwerrboundA * detsum;
+        if (det >= errbound || -det >= errbound) return det;
+        return detail::orient2d_exact(ax, ay, bx, by, cx, cy);
+    }
+
+    // > 0 if d lies inside the circle through counterclockwise a, b, c, < 0 outside, 0 on it (exact sign).
+    inline double incircle(double ax, double ay, double bx, double by, double cx, double cy, double dx, double dy) {
+        const double adx = ax - dx, bdx = bx - dx, cdx = cx - dx;
+        const double ady = ay - dy, bdy = by - dy, cdy = cy - dy;
+        const double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+        const double cdxady = cdx * ady, adxcdy = adx * cdy;
+        const double adxbdy = adx * bdy, bdxady = bdx * ady;
+        const double alift = adx * adx + ady * ady;
+        const double blift = bdx * bdx + bdy * bdy;
+        const double clift = cdx * cdx + cdy * cdy;
+        const double det = alift * (bdxcdy - cdxbdy) + blift * (cdxady - adxcdy) + clift * (adxbdy - bdxady);
+        const double permanent = (std::abs(bdxcdy) + std::abs(cdxbdy)) * alift
+                               + (std::abs(cdxady) + std::abs(adxcdy)) * blift
+                               + (std::abs(adxbdy) + std::abs(bdxady)) * clift;
+        const double errbound = detail::iccerrboundA * permanent;
+        if (det > errbound || -det > errbound) return det;
+        return detail::incircle_exact(ax, ay, bx, by, cx, cy, dx, dy);
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace stats {
+#ifdef DELAUNAY_STATS
+    inline constexpr bool enabled = true;
+#else
+    inline constexpr bool enabled = false;
+#endif
+
+    enum Phase {
+        Sort,
+        Triangulate,
+        Index,
+        Verify,
+        Insert,
+        Edges,
+        Color,
+        Draw,
+        PHASES
+    };
+    inline constexpr const char* phase_name[PHASES] = {
+        "sort", "triangulate", "index", "verify", "insert", "edges", "color", "draw"
+    };
+
+    struct Counters {
+        double seconds[PHASES]{};
+        uint64_t orient{}, in_circle{}, flips{}, allocations{};
+    };
+
+    inline thread_local Counters* sink = nullptr;
+
+    inline void count(uint64_t Counters::* c) {
+        if constexpr (enabled) {
+            if (sink != nullptr) sink->*c += 1;
+        }
+    }
+
+    class Timer {
+    public:
+        explicit Timer(double& s) : out(s) {
+            if constexpr (enabled) t0 = std::chrono::steady_clock::now();
+        }
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+        ~Timer() {
+            if constexpr (enabled) out += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        }
+    private:
+        double& out;
+        std::chrono::steady_clock::time_point t0;
+    };
+
+    class Probe {
+    public:
+        explicit Probe(Counters& c) : Probe(&c) {}
+        explicit Probe(Counters* c) : out(c), prev(sink) {
+            if constexpr (enabled) sink = &local;
+        }
+        Probe(const Probe&) = delete;
+        Probe& operator=(const Probe&) = delete;
+        ~Probe() {
+            if constexpr (enabled) {
+                sink = prev;
+                if (out == nullptr) return;
+                std::atomic_ref(out->orient).fetch_add(local.orient, std::memory_order_relaxed);
+                std::atomic_ref(out->in_circle).fetch_add(local.in_circle, std::memory_order_relaxed);
+            }
+        }
+    private:
+        Counters* out;
+        Counters* prev;
+        Counters local;
+    };
+}
\ No newline at end of file